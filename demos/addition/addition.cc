@@ -43,16 +43,8 @@ int main () {
 
     cl::Program::Sources source(1, std::make_pair(prog.c_str(), prog.length()+1));
 
-    // Create program and kernel
+    // Create program
     cl::Program program(context, source);
-    cl::Kernel kernel(program, "int_sum", &err);
-    checkErr(err, "Kernel::Kernel()");
-
-    // Set the Kernel arguments
-    err = kernel.setArg(0, sizeof(cl_int) * mWidth, NULL);
-    err = kernel.setArg(1, sizeof(cl_int) * mWidth, NULL);
-    err = kernel.setArg(2, sizeof(cl_int) * mWidth, NULL);
-    checkErr(err, "Kernel::setArg()");
 
     err = program.build(devices,"");
     checkErr(file.is_open() ? CL_SUCCESS : -1, "Program::build()");
@@ -82,6 +74,14 @@ int main () {
             &err);
     checkErr(err, "Buffer::Buffer output()");
 
+    // Create the kernel and set its arguments
+    cl::Kernel kernel(program, "int_sum", &err);
+    checkErr(err, "Kernel::Kernel()");
+    err = kernel.setArg(0, mA_buf);
+    err |= kernel.setArg(1, mB_buf);
+    err |= kernel.setArg(2, mC_buf);
+    checkErr(err, "Kernel::setArg()");
+
     // Create the Command Queue
     cl::CommandQueue queue(context, devices[0], 0, &err);
     checkErr(err, "CommandQueue::CommandQueue()");
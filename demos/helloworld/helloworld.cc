@@ -33,14 +33,8 @@ int main () {
 
     cl::Program::Sources source(1, std::make_pair(prog.c_str(), prog.length()+1));
 
-    // Create program and kernel
+    // Create program
     cl::Program program(context, source);
-    cl::Kernel kernel(program, "hello_world", &err);
-    checkErr(err, "Kernel::Kernel()");
-
-    // Set the Kernel arguments
-    err = kernel.setArg(0, strSz, NULL);
-    checkErr(err, "Kernel::setArg()");
 
     // Build the kernel
     err = program.build(devices,"");
@@ -55,6 +49,11 @@ int main () {
 	        &err);
 	checkErr(err, "Buffer::Buffer()");
 
+    // Create the kernel and set its arguments
+    cl::Kernel kernel(program, "hello_world", &err);
+    checkErr(err, "Kernel::Kernel()");
+    err = kernel.setArg(0, str_buf);
+    checkErr(err, "Kernel::setArg()");
 
     // Create the Command Queue
     cl::CommandQueue queue(context, devices[0], 0, &err);
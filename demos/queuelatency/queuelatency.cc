@@ -0,0 +1,125 @@
+#include "ocl.h"
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <vector>
+
+#define ITERATIONS 2000
+#define IDLE_TIME_US 1000000
+
+static double now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double cpu_us(){
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static void report(const char *name, std::vector<double> &samples){
+    double total = 0;
+    std::sort(samples.begin(), samples.end());
+    for(size_t i = 0; i < samples.size(); i++){
+        total += samples[i];
+    }
+    std::cout << name << ": mean " << total / samples.size()
+              << " us, p50 " << samples[samples.size() / 2]
+              << " us, p99 " << samples[samples.size() * 99 / 100]
+              << " us" << std::endl;
+}
+
+int main () {
+    cl_int err;
+    cl_int value = 0;
+
+    // Create the Platform
+    cl::vector<cl::Platform> platformList;
+    cl::Platform::get(&platformList);
+    checkErr(platformList.size() != 0 ? CL_SUCCESS : -1, "cl::Platform::get");
+
+    // Create the Context
+    cl_context_properties cprops[3] = { CL_CONTEXT_PLATFORM,
+            (cl_context_properties)(platformList[0])(), 0 };
+    cl::Context context(CL_DEVICE_TYPE_DEFAULT, cprops, NULL, NULL, &err);
+    checkErr(err, "Context::Context()");
+
+    // Find the Devices
+    cl::vector<cl::Device> devices;
+    devices = context.getInfo<CL_CONTEXT_DEVICES>();
+    checkErr( devices.size() > 0 ? CL_SUCCESS : -1, "devices.size() > 0");
+
+    cl::Buffer buf(context, CL_MEM_READ_WRITE, sizeof(cl_int), NULL, &err);
+    checkErr(err, "Buffer::Buffer()");
+
+    // Create the Command Queue
+    cl::CommandQueue queue(context, devices[0], CL_QUEUE_PROFILING_ENABLE, &err);
+    checkErr(err, "CommandQueue::CommandQueue()");
+
+    // Enqueue-to-dispatch plus completion-to-wakeup, no device traffic
+    std::vector<double> barrier;
+    for(int i = 0; i < ITERATIONS; i++){
+        double start = now_us();
+        err = queue.enqueueBarrier();
+        checkErr(err, "CommandQueue::enqueueBarrier()");
+        err = queue.finish();
+        checkErr(err, "CommandQueue::finish()");
+        barrier.push_back(now_us() - start);
+    }
+    report("barrier + finish", barrier);
+
+    // Split the same path using the command's profiling timestamps
+    std::vector<double> dispatch;
+    std::vector<double> wakeup;
+    for(int i = 0; i < ITERATIONS; i++){
+        cl::Event marker;
+        cl_ulong queued, submit, end;
+        err = queue.enqueueMarker(&marker);
+        checkErr(err, "CommandQueue::enqueueMarker()");
+        err = marker.wait();
+        checkErr(err, "Event::wait()");
+        double woken = now_us();
+        marker.getProfilingInfo(CL_PROFILING_COMMAND_QUEUED, &queued);
+        marker.getProfilingInfo(CL_PROFILING_COMMAND_SUBMIT, &submit);
+        err = marker.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+        checkErr(err, "Event::getProfilingInfo()");
+        dispatch.push_back((submit - queued) / 1e3);
+        wakeup.push_back(woken - end / 1e3);
+    }
+    report("enqueue to dispatch", dispatch);
+    report("completion to wakeup", wakeup);
+
+    // Same path with a device round trip in the middle
+    std::vector<double> read;
+    for(int i = 0; i < ITERATIONS; i++){
+        double start = now_us();
+        err = queue.enqueueReadBuffer(buf, CL_TRUE, 0, sizeof(cl_int), &value);
+        checkErr(err, "CommandQueue::enqueueReadBuffer()");
+        err = queue.finish();
+        checkErr(err, "CommandQueue::finish()");
+        read.push_back(now_us() - start);
+    }
+    report("blocking 4 byte read", read);
+
+    // CPU consumed by an idle queue
+    double cpuStart = cpu_us();
+    double wallStart = now_us();
+    usleep(IDLE_TIME_US);
+    std::cout << "idle queue cpu: "
+              << 100.0 * (cpu_us() - cpuStart) / (now_us() - wallStart)
+              << " %" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+inline void checkErr(cl_int err, const char * name) {
+    if (err != CL_SUCCESS) {
+        std::cerr << "ERROR: " << name << " (" << err << ")" << std::endl;
+        exit( EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,117 @@
+/*!****************************************************************************
+ * @file AddressSpace.cpp Device memory of a host context
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#include "AddressSpace.hpp"
+#include "GlobalDef.hpp"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#if !defined(MPOL_BIND)
+#define MPOL_BIND 2
+#endif
+
+/*!****************************************************************************
+ * @brief mapMemory Reserve device memory. Anonymous pages are zero filled
+ *        by the kernel on first touch, so nothing is cleared up front.
+ * @param size Bytes requested, rounded up to the page size used
+ * @param hugePages Try hugetlb pages, then transparent huge pages
+ * @param mapped Returns the size of the mapping
+ * @return Start of the mapping, MAP_FAILED on error
+ * ***************************************************************************/
+static char* mapMemory(size_t size, bool hugePages, size_t *mapped){
+    void *mem = MAP_FAILED;
+    size_t page = sysconf(_SC_PAGESIZE);
+
+    if(hugePages){
+        /*! Reserved up front: without a reservation a short hugetlb pool
+         *  shows up as SIGBUS on first touch instead of a failed mmap */
+        *mapped = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        mem = mmap(NULL, *mapped, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(mem == MAP_FAILED){
+            perror("[DEV] No hugetlb pages, using transparent huge pages");
+        }
+    }
+    if(mem == MAP_FAILED){
+        *mapped = (size + page - 1) & ~(page - 1);
+        mem = mmap(NULL, *mapped, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(mem != MAP_FAILED && hugePages){
+            madvise(mem, *mapped, MADV_HUGEPAGE);
+        }
+    }
+    return (char *)mem;
+}
+
+/*!****************************************************************************
+ * @brief bindMemory Place device memory on one NUMA node
+ * @return 0 on success, -1 on error
+ * ***************************************************************************/
+static int bindMemory(char *mem, size_t size, int node){
+    unsigned long nodemask[16] = {0};
+    const unsigned long bits = sizeof(unsigned long) * 8;
+
+    if(node < 0 || (unsigned long)node >= sizeof(nodemask) * 8){
+        return -1;
+    }
+    nodemask[node / bits] = 1UL << (node % bits);
+    return syscall(SYS_mbind, mem, size, MPOL_BIND, nodemask, sizeof(nodemask) * 8, 0);
+}
+
+/*!****************************************************************************
+ * @brief Constructor, maps fresh zero filled memory. Throws if the memory
+ *        cannot be had.
+ * @param key Host context the space belongs to
+ * @param memSize Bytes of global memory
+ * @param hugePages Back the memory with huge pages where possible
+ * @param numaNode Node to bind the memory to, -1 for no binding
+ * ***************************************************************************/
+AddressSpace::AddressSpace(uint64_t key, size_t memSize, bool hugePages, int numaNode){
+    this->data = mapMemory(memSize, hugePages, &(this->mappedSize));
+    if(this->data == MAP_FAILED){
+        perror("[DEV] Unable to map device memory");
+        throw -1;
+    }
+    if(numaNode >= 0 && bindMemory(this->data, this->mappedSize, numaNode) < 0){
+        perror("[DEV] Unable to bind device memory");
+        munmap(this->data, this->mappedSize);
+        throw -1;
+    }
+    this->key = key;
+    this->refs = 0;
+    this->memSize = memSize;
+    pthread_mutex_init(&(this->data_mx), NULL);
+}
+
+/*!****************************************************************************
+ * @brief Destructor, the memory goes back to the system
+ * ***************************************************************************/
+AddressSpace::~AddressSpace(){
+    munmap(this->data, this->mappedSize);
+    pthread_mutex_destroy(&(this->data_mx));
+}
+
+/*!****************************************************************************
+ * @brief Device memory dump.
+ * ***************************************************************************/
+int AddressSpace::memdump(){
+    unsigned int len, i;
+
+    pthread_mutex_lock(&data_mx);
+    len = memSize;
+    for(i=0; i<len; i++){
+        if(i%16==0) fprintf(stderr, "\n");
+        if(data[i] == '\n')
+            fprintf(stderr, "\\N ");
+        else if(data[i] == '0')
+            fprintf(stderr, ".. ");
+        else
+            fprintf(stderr, "%2x ", data[i]);
+    }
+    fprintf(stderr, "\n");
+    pthread_mutex_unlock(&data_mx);
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*!****************************************************************************
+ * @file AddressSpace.hpp Device memory of a host context Definitions
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#if !defined(ADDRESSSPACE_HPP)
+#define ADDRESSSPACE_HPP
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * Global memory seen by one host context. Every session the context opens
+ * shares it; sessions of other contexts have spaces of their own, so buffer
+ * addresses handed out by one host never reach memory of another.
+ */
+class AddressSpace{
+  size_t mappedSize;
+
+public:
+  uint64_t key;                 /*! Chosen by the host context */
+  int refs;                     /*! Sessions attached, kept by Device */
+  pthread_mutex_t data_mx;
+  char *data;
+  size_t memSize;
+
+  AddressSpace(uint64_t key, size_t memSize, bool hugePages, int numaNode);
+  ~AddressSpace();
+  int memdump();
+};
+
+#endif //ADDRESSSPACE_HPP
@@ -5,101 +5,63 @@
 
 #include "ComputeUnit.hpp"
 #include "debug.h"
+#include <time.h>
+
+__thread novelcl_context_t novelcl_context;
 
 /*!****************************************************************************
  * @brief Compute Unit constructor
  * @param parent Reference to an IScheduler
  * @param designation ComputeUnit Unique ID
- * @param dataPtr Pointer to data memory.
+ * @param cpus Where compute units run
  *****************************************************************************/
-ComputeUnit::ComputeUnit(IScheduler *parent, int designation, 
-                         char *dataPtr){
-    this->data = dataPtr;
+ComputeUnit::ComputeUnit(IScheduler *parent, int designation, const CpuLayout *cpus){
     this->parent = parent;
     this->thread = 0;
     this->threadAllocated = false;
     this->designation = designation;
-    this->dlHandle = NULL;
+    this->launch = NULL;
+    this->busyNs = 0;
+    this->ranges = 0;
+    this->items = 0;
+    this->cpu = cpus->cpuOf(designation);
+    this->hasAffinity = cpus->unitAffinity(designation, &(this->affinity));
 #if defined(ENABLE_THREAD_POOL)
     pthread_mutex_init(&(this->cuState_mx), NULL);
     pthread_cond_init(&(this->cuState_cond), NULL);
-    pthread_create(&(this->thread), NULL, cu_thread_start, this);
+    this->start_thread();
 #endif
 }
 
 /*!****************************************************************************
- * @brief Set kernel to be executed
- * @param lib_name Kernel file name
+ * @brief Start the compute unit thread on its CPUs
  *****************************************************************************/
-void ComputeUnit::set_kernel(char *lib_name){
-    char* error;
-    
-    if(this->dlHandle){
-      dlclose(this->dlHandle);
-        error = dlerror();
-        if (error) {
-            DEBUG("%s\n", error);
-            exit(EXIT_FAILURE);
-        }
-      DEBUG("Closing handle for %d\n", this->designation);
-      this->pfnKernelWrapper = NULL;
-      this->dlHandle = NULL;
-    }
+void ComputeUnit::start_thread(){
+    pthread_attr_t attr;
     
-    /* link with kernel compiled as shared library */
-    //fprintf(stderr, "Opening %s\n", lib_name);
-    this->dlHandle = dlopen( lib_name, RTLD_NOW);
-    error = dlerror();
-    if (error) {
-        DEBUG("%s\n", error);
-        exit(EXIT_FAILURE);
+    pthread_attr_init(&attr);
+    if(this->hasAffinity){
+        pthread_attr_setaffinity_np(&attr, sizeof(this->affinity), &(this->affinity));
     }
-    this->pfnKernelWrapper = (void (*)(int, int, int, void *))dlsym(this->dlHandle, "kernel_wrapper");
-    dlerror(); /* clear previous error */
-    if ((error = dlerror()) != NULL)  {
-        DEBUG("%s\n", dlerror());
-        exit(EXIT_FAILURE);
+    if(pthread_create(&(this->thread), &attr, cu_thread_start, this) != 0){
+        perror("[DEV] Unable to start compute unit");
     }
+    pthread_attr_destroy(&attr);
 }
 
 /*!****************************************************************************
- * @brief Unset kernel 
+ * @brief Start kernel execution. The compute unit runs ranges of work items
+ *        claimed from the scheduler until none are left.
+ * @param launch Kernel, work size and arguments, valid until CUDone
  *****************************************************************************/
-void ComputeUnit::unset_kernel(){
-    char* error;
-    
-    if(this->dlHandle){
-      dlclose(this->dlHandle);
-        error = dlerror();
-        if (error) {
-            DEBUG("%s\n", error);
-            exit(EXIT_FAILURE);
-        }
-      DEBUG("Closing handle for %d\n", this->designation);
-      this->pfnKernelWrapper = NULL;
-      this->dlHandle = NULL;
-    }
-}
-
-
-/*!****************************************************************************
- * @brief Start kernel execution
- * @param z 3rd dimension of execution
- * @param y 2nd dimension of execution
- * @param x 1st dimension of execution
- *****************************************************************************/
-void ComputeUnit::run_kernel(int z, int y, int x){
-    char* error;
-    this->globalX = x;
-    this->globalY = y;
-    this->globalZ = z;
-
+void ComputeUnit::run_kernel(const KernelLaunch *launch){
+    this->launch = launch;
     //Start the thread
-    DEBUG("Calling Designation %d, Instance %d:%d:%d\n", this->designation, z, y, x);
+    DEBUG("Calling Designation %d\n", this->designation);
 #if !defined(ENABLE_THREAD_POOL)
     this->join();
     this->threadAllocated = true;
-    pthread_create(&(this->thread), NULL, cu_thread_start, this);
+    this->start_thread();
 #else
     pthread_mutex_lock(&(this->cuState_mx));
     this->threadAllocated = true;
@@ -108,6 +70,30 @@ void ComputeUnit::run_kernel(int z, int y, int x){
 #endif
 }
 
+/*!****************************************************************************
+ * @brief Run the kernel over ranges until the launch is exhausted
+ *****************************************************************************/
+void ComputeUnit::run_ranges(){
+    unsigned int begin[3], end[3];
+    struct timespec start, stop;
+    
+    while(this->parent->nextRange(this, begin, end)){
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        this->launch->entry(begin, end, this->launch->globalSize, 
+                            this->launch->globalOffset, this->launch->data, 
+                            this->launch->args);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        /*! Read and reset by takeStats on another thread */
+        __atomic_add_fetch(&(this->busyNs), (stop.tv_sec - start.tv_sec) * 1000000000UL + 
+                           stop.tv_nsec - start.tv_nsec, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&(this->ranges), 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&(this->items), (unsigned long)(end[0] - begin[0]) * 
+                           (end[1] - begin[1]) * (end[2] - begin[2]), __ATOMIC_RELAXED);
+        DEBUG("%d %u:%u:%u-%u:%u:%u EXD\n", this->designation, begin[2], begin[1], 
+              begin[0], end[2], end[1], end[0]);
+    }
+}
+
 /*!****************************************************************************
  * @brief Start of thread function, required for pthread
  * @param arg Pointer to an instance of ComputeUnit
@@ -127,14 +113,12 @@ void* ComputeUnit::cu_thread(){
         pthread_cond_wait(&(this->cuState_cond), &(this->cuState_mx));
     }
     pthread_mutex_unlock(&(this->cuState_mx));
-    this->pfnKernelWrapper(this->globalX, this->globalY, this->globalZ, this->data);
+    this->run_ranges();
     this->threadAllocated = false;
-    DEBUG("%d %d:%d:%d EXD\n", this->designation, this->globalZ, this->globalY, this->globalX);
     this->parent->CUDone(this);
   }
 #else
-  this->pfnKernelWrapper(this->globalX, this->globalY, this->globalZ, this->data);
-  DEBUG("%d %d:%d:%d EXD\n", this->designation, this->globalZ, this->globalY, this->globalX);
+  this->run_ranges();
   this->parent->CUDone(this);
 #endif
 }
@@ -151,12 +135,21 @@ void ComputeUnit::join(){
 #endif
 }
 
+/*!****************************************************************************
+ * @brief Utilisation since the last call
+ * @param busyNs Returns the time spent running work items
+ * @param ranges Returns the ranges run
+ * @param items Returns the work items run
+ *****************************************************************************/
+void ComputeUnit::takeStats(unsigned long *busyNs, unsigned long *ranges, 
+                            unsigned long *items){
+    *busyNs = __atomic_exchange_n(&(this->busyNs), 0, __ATOMIC_RELAXED);
+    *ranges = __atomic_exchange_n(&(this->ranges), 0, __ATOMIC_RELAXED);
+    *items = __atomic_exchange_n(&(this->items), 0, __ATOMIC_RELAXED);
+}
+
 /*!****************************************************************************
  * @brief Compute Unit Destructor
  *****************************************************************************/
 ComputeUnit::~ComputeUnit(){
-  if(this->dlHandle){
-    dlclose(this->dlHandle);
-    this->dlHandle = NULL;
-  }
 }
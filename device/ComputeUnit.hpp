@@ -10,33 +10,48 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <pthread.h>
-#include <dlfcn.h>
+#include <sched.h>
 #include "IScheduler.hpp"
+#include "CpuLayout.hpp"
 
-typedef void (*pfnKernelWrapper_t)(int x, int y, int z, void* mem);
+/*! Work-item context the kernel builtins read, mirrors host/include/kernel.h.
+ *  The kernel wrapper fills it in, each compute unit thread has its own. It 
+ *  is exported to kernel images, see kernel.dynlist. */
+typedef struct {
+    size_t global_id[3];
+    size_t global_size[3];
+    size_t global_offset[3];
+} novelcl_context_t;
+extern "C" __thread novelcl_context_t novelcl_context;
 
 class ComputeUnit{
-    char *data;
     pthread_mutex_t cuState_mx;
     pthread_cond_t cuState_cond;
-    int globalX, globalY, globalZ;
-    void* dlHandle;
     IScheduler *parent; 
     pthread_t thread;
     bool threadAllocated;
-    pfnKernelWrapper_t pfnKernelWrapper;
+    const KernelLaunch *launch; /*! Launch being run */
+    cpu_set_t affinity;
+    bool hasAffinity;
+    
+    /*! Utilisation since the last report */
+    unsigned long busyNs;
+    unsigned long ranges;
+    unsigned long items;
     
 private:
+    void start_thread();
     static void* cu_thread_start(void *arg); 
     void* cu_thread(); 
+    void run_ranges(void);
 public:
     int designation;
-    ComputeUnit(IScheduler *parent, int designation, char *dataPtr);
+    int cpu;                    /*! Pinned to, -1 if not pinned */
+    ComputeUnit(IScheduler *parent, int designation, const CpuLayout *cpus);
     ~ComputeUnit();
-    void set_kernel(char *lib_name);
-    void unset_kernel(void);
-    void run_kernel(int x, int y, int z);
+    void run_kernel(const KernelLaunch *launch);
     void join();
+    void takeStats(unsigned long *busyNs, unsigned long *ranges, unsigned long *items);
 };
 
 #endif //COMPUTEUNIT_HPP
\ No newline at end of file
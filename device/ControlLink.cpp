@@ -4,323 +4,1099 @@
  *****************************************************************************/
 #include "GlobalDef.hpp"
 #include "ControlLink.hpp"
+#include "ControlListener.hpp"
 #include "IScheduler.hpp"
 #include "debug.h"
+#include <time.h>
+#include <endian.h>
+#include <errno.h>
+#include <sys/mman.h>
 
+/*!****************************************************************************
+ * @brief deviceClock Clock used for kernel timing reports
+ * @return monotonic time in ns
+ * ***************************************************************************/
+static uint64_t deviceClock(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief memoryRange Check an access against the device memory
+ * @param size Bytes of device memory
+ * @return true if [offset, offset + length) lies in device memory
+ * ***************************************************************************/
+static bool memoryRange(uint64_t offset, uint64_t length, uint64_t size){
+    return length <= size && offset <= size - length;
+}
+
+/*!****************************************************************************
+ * @brief Constructor, one session per host connection. Throws if the 
+ *        receive buffer cannot be had.
+ * @param parent Device the session operates on
+ * @param connfd Accepted connection
+ * @param session Session number, used to keep kernel images apart
  * ***************************************************************************/
-ControlLink::ControlLink(Device *parent){
+ControlLink::ControlLink(Device *parent, int connfd, int session): ring(MAXBUF){
   pthread_mutex_init(&ctrl_mx, NULL);
   pthread_cond_init(&ctrl_cond, NULL);
   pthread_mutex_init(&ctrl_condmx, NULL);
   
+  pthread_mutex_init(&send_mx, NULL);
+  pthread_mutex_init(&exec_mx, NULL);
+  pthread_cond_init(&exec_cond, NULL);
+  stopping = false;
+  
   ctrlState = CTRL_STATE_IDLE;
-  kernelValid = 0;
+  kernelClock = 0;
+  loading = NULL;
+  imagefd = -1;
+  imageSum = IMAGE_HASH_INIT;
+  transferFailed = false;
+  finished = false;
+  inbound = NULL;
+  inboundLeft = 0;
+  inboundFlags = 0;
+  parked = false;
+  requestId = 0;
+  space = NULL;
+  this->session = session;
+  this->connfd = connfd;
   this->parent = parent;
-  pthread_mutex_init(&(parent->data_mx), NULL);
   
 }
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief Destructor, ends the session once stop has been called. The 
+ *        executor has let the sender finish by then.
+ * ***************************************************************************/
+ControlLink::~ControlLink(){
+    std::map<uint64_t, ResidentKernel>::iterator it;
+    
+    pthread_join(executor, NULL);
+    close(connfd);
+    if(imagefd >= 0){
+        close(imagefd);
+    }
+    if(loading != NULL){
+        pthread_join(loading->thread, NULL);
+        parent->kernels->release(loading->kernel);
+        delete loading;
+    }
+    for(it = resident.begin(); it != resident.end(); it++){
+        parent->kernels->release(it->second.kernel);
+    }
+    parent->detach(space);
+    fprintf(stderr, "[CTRL] Session %d closed\n", session);
+}
+
+/*!****************************************************************************
+ * @brief start Start the sender and the executor, the session is served 
+ *        from then on
+ * ***************************************************************************/
+void ControlLink::start(){
+    fprintf(stderr, "[CTRL] New connection, session %d\n", session);
+    pthread_create(&sender, NULL, send_thread_start, this);
+    pthread_create(&executor, NULL, exec_thread_start, this);
+}
+
+/*!****************************************************************************
+ * @brief stop End the session after the host went away. The running kernel
+ *        finishes, queued ones are dropped, as are reads not yet sent.
+ * ***************************************************************************/
+void ControlLink::stop(){
+    pthread_mutex_lock(&exec_mx);
+    stopping = true;
+    parked = false;
+    pthread_cond_broadcast(&exec_cond);
+    pthread_mutex_unlock(&exec_mx);
+}
+
+/*!****************************************************************************
+ * @brief isFinished Check whether the session has stopped and its executor 
+ *        exited, so it can be deleted without waiting
+ * ***************************************************************************/
+bool ControlLink::isFinished(){
+  return __atomic_load_n(&finished, __ATOMIC_ACQUIRE);
+}
+
+/*!****************************************************************************
+ * @brief fd Connection to the host
  * ***************************************************************************/
-void* ControlLink::act_func(){
-    int fd;
-    struct sockaddr_in ctrl_addr;
-    socklen_t ctrl_addr_len = sizeof(ctrl_addr);
-    char buf[MAXBUF];
-    ssize_t rcount, wcount, acklen;
-    size_t buflen = 0;
-    int consumed = 0;
-
-    fprintf(stderr, "[CTRL] Thread started\n");
-    /* accept new control connection */
-    fd = this->act_fd;
-    if((connfd = accept(fd, (struct sockaddr *) &ctrl_addr, &ctrl_addr_len)) == -1){
-        perror("[CTRL] Unable to connect with interface");
-        close(fd);
-        pthread_exit(NULL);
-    }
-
-    perror("[CTRL] New connection"); 
-    buflen = 0;
-    while((rcount = recv(connfd, buf+buflen, MAXBUF - buflen, 0)) != 0){
-        fprintf(stderr, "[CTRL] rcount %d\n", rcount);       
+int ControlLink::fd(){
+    return connfd;
+}
+
+/*!****************************************************************************
+ * @brief isParked Check whether the session waits for its executor before 
+ *        handling more packets. The listener serves it again on a wake up.
+ * ***************************************************************************/
+bool ControlLink::isParked(){
+    bool ret;
+    
+    pthread_mutex_lock(&exec_mx);
+    ret = parked;
+    pthread_mutex_unlock(&exec_mx);
+    return ret;
+}
+
+/*!****************************************************************************
+ * @brief serve Handle what the host has sent, called by the listener when 
+ *        the connection is readable or the session was parked. Never 
+ *        blocks on the host: packets held back go first, then whatever can
+ *        be read without waiting, up to SESSION_READ_BURST reads. While a
+ *        write's data is coming in, it is read straight into device memory,
+ *        and only the header after it into the buffer, so that the next 
+ *        chunk's data goes straight to device memory as well.
+ * @return 0 to keep serving, -1 once the session has to end
+ * ***************************************************************************/
+int ControlLink::serve(){
+    const size_t writeHeader = COMM_HEADER_LENGTH + sizeof(MemReadWrite_t);
+    struct iovec iov[2];
+    struct msghdr msg;
+    ssize_t rcount;
+    size_t direct;
+    int reads = 0;
+    
+    if(processBuffer() < 0){
+        return -1;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    while(!parked && reads < SESSION_READ_BURST){
+        if(inboundLeft > 0){
+            iov[0].iov_base = inbound;
+            iov[0].iov_len = inboundLeft;
+            iov[1].iov_base = ring.space();
+            iov[1].iov_len = (ring.room() < writeHeader) ? ring.room() : writeHeader;
+            msg.msg_iovlen = 2;
+        }else{
+            iov[0].iov_base = ring.space();
+            iov[0].iov_len = ring.room();
+            msg.msg_iovlen = 1;
+        }
+        if(inboundLeft > 0){
+            pthread_mutex_lock(&(space->data_mx));
+            rcount = recvmsg(connfd, &msg, MSG_DONTWAIT);
+            pthread_mutex_unlock(&(space->data_mx));
+        }else{
+            rcount = recvmsg(connfd, &msg, MSG_DONTWAIT);
+        }
+        if(rcount == 0){
+            return -1;
+        }
         if(rcount < 0){
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
             perror("[CTRL] Unable to read from host");
-            close(fd);
-            pthread_exit(NULL);
+            return -1;
         }
-        buflen += rcount;
-        fprintf(stderr, "[CTRL] recv %zd bytes\n", rcount);
-        if((consumed = processPacket(buf, buflen))){
-            fprintf(stderr, "[CTRL] Processed 1 packet, consumed %d\n", consumed);
-            if(buflen - consumed){
-                printf("memmov from %d to %d size %d\n", consumed, 0, buflen - consumed);
-                memcpy(buf, buf+consumed, buflen - consumed);
+        reads++;
+        DEBUG("%s: recv %zd bytes\n", __func__, rcount);
+        if(inboundLeft > 0){
+            direct = ((size_t)rcount < inboundLeft) ? rcount : inboundLeft;
+            inbound += direct;
+            inboundLeft -= direct;
+            rcount -= direct;
+            if(inboundLeft == 0){
+                finishChunk(inboundFlags, true);
             }
-            buflen -= consumed;
-
         }
-        fprintf(stderr, "[CTRL] buflen %d\n", buflen);
-        printf("MAXBUF - buflen = %d\n", MAXBUF - buflen);
+        ring.fill(rcount);
+        if(processBuffer() < 0){
+            return -1;
+        }
     }
-    close(connfd);
-    close(fd);
-    fprintf(stderr, "[CTRL] Thread stopped\n");
+    return 0;
+}
+
+/*!****************************************************************************
+ * @brief processBuffer Handle every complete packet in the buffer, up to 
+ *        one that has to wait for the executor
+ * @return 0 on success, -1 if the stream cannot be parsed
+ * ***************************************************************************/
+int ControlLink::processBuffer(){
+    int processed = 0;
     
-    return NULL;
+    pthread_mutex_lock(&exec_mx);
+    parked = false;
+    pthread_mutex_unlock(&exec_mx);
+    /*! Chunked transfers arrive back to back, handle every complete packet */
+    while(inboundLeft == 0 && (processed = processPacket(ring.data(), ring.length())) > 0){
+        ring.consume(processed);
+    }
+    return (processed < 0) ? -1 : 0;
 }
 
 /*!****************************************************************************
  * @brief processPacket Process a packet if enough bytes are in the buffer
- * @param loadkernel pointer to Load kernel command payload
- * @return Bytes consumed. 
+ * @param packet Start of the packet
+ * @param buflen Bytes available
+ * @return Bytes consumed, 0 if the packet is incomplete or has to wait, -1 
+ *         if the stream cannot be parsed and the session must end. 
  * ***************************************************************************/
 int ControlLink::processPacket(char *packet, size_t buflen){
     CommPacket_t *cmdPkt = (CommPacket_t *)packet;
-    fprintf(stderr, "[CTRL] processpacket len %zd\n", buflen);
-    fprintf(stderr, "[CTRL] offsetof cmdID len %zd\n", offsetof(CommPacket_t, cmdId));
-    
-    if(buflen >= offsetof(CommPacket_t, cmdId)){
-        fprintf(stderr, "[CTRL] cmd len %zd\n", ntohs(cmdPkt->length));
-        if(ntohs(cmdPkt->length) > buflen) return 0;
-          
-        /*! We have enough data, process the packet*/
-        switch(cmdPkt->cmdId){
-            case RESET:
-                handleReset();
-                break;
-            case MEM_WRITE_CMD:
-                handleMemoryWrite(&(cmdPkt->payload.write));
+    size_t length;
+    size_t payloadLength;
+    uint16_t flags;
+    
+    if(buflen < COMM_HEADER_LENGTH) return 0;
+    if(cmdPkt->version != MORACL_PROTOCOL_VERSION){
+        fprintf(stderr, "[CTRL] Unsupported protocol version %d\n", cmdPkt->version);
+        return -1;
+    }
+    length = ntohl(cmdPkt->length);
+    if(length < COMM_HEADER_LENGTH || length > MAXBUF){
+        fprintf(stderr, "[CTRL] Bad packet length %zd\n", length);
+        return -1;
+    }
+    /*! A write's data need not be in, only what precedes it */
+    if(length > buflen && (cmdPkt->cmdId != MEM_WRITE_CMD || 
+                           buflen < COMM_HEADER_LENGTH + sizeof(MemReadWrite_t))){
+        return 0;
+    }
+    payloadLength = length - COMM_HEADER_LENGTH;
+    flags = ntohs(cmdPkt->flags);
+    /*! Left in the buffer until the launches it depends on are done */
+    if(mustWait(cmdPkt, payloadLength)){
+        return 0;
+    }
+    /*! Answers go back under the request's id */
+    requestId = cmdPkt->id;
+    if(length > buflen){
+        return startMemoryWrite(&(cmdPkt->payload.write), flags, 
+                                payloadLength - sizeof(MemReadWrite_t), 
+                                buflen - COMM_HEADER_LENGTH - sizeof(MemReadWrite_t));
+    }
+    DEBUG("%s: cmd 0x%02X len %zd\n", __func__, cmdPkt->cmdId, length);
+      
+    /*! We have enough data, process the packet*/
+    switch(cmdPkt->cmdId){
+        case RESET:
+            handleReset();
+            break;
+        case HELLO:
+            if(payloadLength < sizeof(Hello_t)){
+                sendErr();
                 break;
-            case MEM_READ_CMD:
-                handleMemoryRead(&(cmdPkt->payload.read));
+            }
+            handleHello(&(cmdPkt->payload.hello));
+            break;
+        case MEM_WRITE_CMD:
+            if(payloadLength < sizeof(MemReadWrite_t)){
+                finishChunk(flags, false);
                 break;
-            case LOAD_KERNEL_IMAGE:
-                handleKernelLoad(&(cmdPkt->payload.loadkernel));
+            }
+            handleMemoryWrite(&(cmdPkt->payload.write), flags, 
+                              payloadLength - sizeof(MemReadWrite_t));
+            break;
+        case MEM_READ_CMD:
+            if(payloadLength < sizeof(MemReadWrite_t)){
+                sendErr();
                 break;
-            case START_KERNEL:
-                handleStartProcessing();
+            }
+            handleMemoryRead(&(cmdPkt->payload.read));
+            break;
+        case LOAD_KERNEL_IMAGE:
+            if(payloadLength < sizeof(LoadKernel_t)){
+                finishChunk(flags, false);
                 break;
-            case GLOBAL_WORK_SIZE:
-                handleGlobalWorkSize(&(cmdPkt->payload.globalWorkSize));
+            }
+            handleKernelLoad(&(cmdPkt->payload.loadkernel), flags, 
+                             payloadLength - sizeof(LoadKernel_t));
+            break;
+        case OFFER_KERNEL:
+            if(payloadLength < sizeof(KernelOffer_t)){
+                sendErr();
                 break;
-            default:
-                fprintf(stderr, "[CTRL] Unrecognised command 0x%02X\n", cmdPkt->cmdId);
+            }
+            handleKernelOffer(&(cmdPkt->payload.offer));
+            break;
+        case LAUNCH_KERNEL:
+            if(payloadLength < sizeof(LaunchKernel_t)){
                 sendErr();
                 break;
-            
-        }
-        return ntohs(cmdPkt->length);
+            }
+            handleLaunch(&(cmdPkt->payload.launch), payloadLength);
+            break;
+        default:
+            fprintf(stderr, "[CTRL] Unrecognised command 0x%02X\n", cmdPkt->cmdId);
+            sendErr();
+            break;
         
     }
-    return 0;
+    return length;
 }
 
 /*!****************************************************************************
- * @brief handleReset Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief sendVector Send a gather list as one packet, resuming partial sends
+ * @return 0 on success, -1 on error
+ * ***************************************************************************/
+int ControlLink::sendVector(struct iovec *iov, int iovcnt){
+    ssize_t wcount;
+    int ret = 0;
+    
+    /*! Packets from the executor must not land inside this one */
+    pthread_mutex_lock(&send_mx);
+    while(iovcnt > 0){
+        wcount = writev(connfd, iov, iovcnt);
+        if(wcount < 0){
+            if(errno == EINTR)
+                continue;
+            ret = -1;
+            break;
+        }
+        while(iovcnt > 0 && (size_t)wcount >= iov->iov_len){
+            wcount -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if(iovcnt > 0){
+            iov->iov_base = (char *)iov->iov_base + wcount;
+            iov->iov_len -= wcount;
+        }
+    }
+    pthread_mutex_unlock(&send_mx);
+    return ret;
+}
+
+/*!****************************************************************************
+ * @brief sendPacket Send a packet held in one buffer
+ * @return 0 on success, -1 on error
+ * ***************************************************************************/
+int ControlLink::sendPacket(const void *packet, size_t length){
+    struct iovec iov;
+    
+    iov.iov_base = (void *)packet;
+    iov.iov_len = length;
+    return sendVector(&iov, 1);
+}
+
+/*!****************************************************************************
+ * @brief finishChunk Record the outcome of one chunk of a transfer, the last 
+ *        chunk answers for the whole transfer
+ * @param flags Flags of the chunk's packet
+ * @param ok Whether this chunk was applied
+ * ***************************************************************************/
+int ControlLink::finishChunk(uint16_t flags, bool ok){
+    if(!ok){
+        transferFailed = true;
+    }
+    if(flags & MORACL_FLAG_MORE){
+        return 0;
+    }
+    ok = !transferFailed;
+    transferFailed = false;
+    return ok ? sendAck() : sendErr();
+}
+
+/*!****************************************************************************
+ * @brief handleReset Drop the kernels the session holds. mustWait keeps a 
+ *        reset back while an upload loads.
  * ***************************************************************************/
 int ControlLink::handleReset(){
-    kernelValid = false;
+    std::map<uint64_t, ResidentKernel>::iterator it;
+    
+    for(it = resident.begin(); it != resident.end(); it++){
+        parent->kernels->release(it->second.kernel);
+    }
+    resident.clear();
     return 0;  
 }
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief holdKernel Make a kernel one the session holds, letting go of the 
+ *        one used longest ago beyond MORACL_SESSION_KERNELS. The host keeps
+ *        track of the same order, so it knows what the session holds.
+ * @param hash Image hash the host names the kernel by
+ * @param kernel Reference handed over, NULL while the image loads
+ * ***************************************************************************/
+void ControlLink::holdKernel(uint64_t hash, LoadedKernel *kernel){
+    std::map<uint64_t, ResidentKernel>::iterator it, oldest;
+    ResidentKernel *entry = &(resident[hash]);
+    
+    parent->kernels->release(entry->kernel);
+    entry->kernel = kernel;
+    entry->lastUse = ++kernelClock;
+    while(resident.size() > MORACL_SESSION_KERNELS){
+        oldest = resident.end();
+        for(it = resident.begin(); it != resident.end(); it++){
+            /*! The image loading is the one used last */
+            if(it->second.kernel != NULL && 
+               (oldest == resident.end() || it->second.lastUse < oldest->second.lastUse)){
+                oldest = it;
+            }
+        }
+        DEBUG("%s: Kernel %016llx let go.\n", __func__, (unsigned long long)oldest->first);
+        parent->kernels->release(oldest->second.kernel);
+        resident.erase(oldest);
+    }
+}
+
+/*!****************************************************************************
+ * @brief reapLoad Put a loaded upload in its place among the kernels the 
+ *        session holds, or drop its place if it failed. Must be called with
+ *        exec_mx held.
+ * ***************************************************************************/
+void ControlLink::reapLoad(){
+    std::map<uint64_t, ResidentKernel>::iterator it;
+    
+    if(loading == NULL || !loading->done){
+        return;
+    }
+    pthread_join(loading->thread, NULL);
+    it = resident.find(loading->hash);
+    if(loading->kernel != NULL){
+        it->second.kernel = loading->kernel;
+    }else{
+        resident.erase(it);
+    }
+    delete loading;
+    loading = NULL;
+}
+
+/*!****************************************************************************
+ * @brief Start of a loader thread, required for pthread
+ * ***************************************************************************/
+void* ControlLink::load_thread_start(void *arg){
+    return ((ControlLink *)arg)->load_thread();
+}
+
+/*!****************************************************************************
+ * @brief load_thread Load the last upload and answer its last chunk. A 
+ *        session parked on the image is handed back to the listener.
+ * ***************************************************************************/
+void* ControlLink::load_thread(){
+    loading->kernel = parent->kernels->load(loading->fd, loading->hash, loading->size);
+    sendStatus(loading->kernel ? CTRL_ACK : CTRL_NAK, loading->id);
+    
+    pthread_mutex_lock(&exec_mx);
+    loading->done = true;
+    if(parked){
+        parent->controller->wake();
+    }
+    pthread_mutex_unlock(&exec_mx);
+    return NULL;
+}
+
+/*!****************************************************************************
+ * @brief handleHello Answer the host's handshake with our protocol version 
+ *        and memory size, and attach to the address space of the host's 
+ *        context
+ * @param hello pointer to Hello payload
+ * ***************************************************************************/
+int ControlLink::handleHello(Hello_t *hello){
+    CommPacket_t ack;
+    int len = COMM_HEADER_LENGTH + sizeof(Hello_t);
+    uint64_t context = be64toh(hello->context);
+    
+    fprintf(stderr, "[CTRL] Host speaks protocol version %d\n", ntohl(hello->version));
+    /*! Queued launches use the space, so a session keeps the first one */
+    if(space != NULL && space->key != context){
+        fprintf(stderr, "[CTRL] Session already belongs to another context\n");
+        return sendErr();
+    }
+    if(space == NULL && context != 0 && (space = parent->attach(context)) == NULL){
+        return sendErr();
+    }
+    ack.version = MORACL_PROTOCOL_VERSION;
+    ack.cmdId = CTRL_ACK;
+    ack.flags = 0;
+    ack.id = requestId;
+    ack.length = htonl(len);
+    ack.payload.hello.version = htonl(MORACL_PROTOCOL_VERSION);
+    ack.payload.hello.memSize = htobe64(parent->memSize);
+    ack.payload.hello.context = htobe64(context);
+    if(sendPacket(&ack, len) < 0){
+        perror("[CTRL] Unable to send hello");
+        return -1;
+    }
+    return 0;
+}
+
+/*!****************************************************************************
+ * @brief handleMemoryRead Queue a read for the sender to stream back. 
+ *        mustWait kept it back while the queue was full.
+ * @param read pointer to Memory read command payload
  * ***************************************************************************/
 int ControlLink::handleMemoryRead(MemReadWrite_t *read){
-    int offset = ntohl(read->offset);
-    int accessLength = ntohl(read->accessLength);
-    
-    ssize_t wcount, sentLen;
-    uint8_t replyBuf[64*1024];
-    int rspLength;
-    CommPacket_t *readRsp = (CommPacket_t *)replyBuf;
-
-    readRsp->version = MORACL_PROTOCOL_VERSION;
-    readRsp->cmdId = MEM_READ_RSP_CMD;        
-    readRsp->payload.read.offset = htonl(offset);
-    readRsp->payload.read.accessLength = htonl(accessLength);
-                    
-    /* read from device memory */
-    pthread_mutex_lock(&(parent->data_mx));
-    memcpy(readRsp->payload.read.data, parent->data+offset, accessLength);
-    pthread_mutex_unlock(&(parent->data_mx));
-                    
-    rspLength = 4 + 8 + accessLength;
-    readRsp->length = htonl(rspLength);
-          
-    sentLen = 0;
-    while(sentLen < rspLength){
-        wcount = send(connfd, readRsp + sentLen, rspLength - sentLen, 0);
-        if(wcount < 0){
+    PendingRead pending;
+    
+    pending.offset = be64toh(read->offset);
+    pending.length = be64toh(read->accessLength);
+    pending.id = requestId;
+    if(space == NULL || !memoryRange(pending.offset, pending.length, space->memSize)){
+        fprintf(stderr, "[CTRL] Read outside device memory. Off %llx, access %llx\n", 
+                (unsigned long long)pending.offset, (unsigned long long)pending.length);
+        return sendErr();
+    }
+    pthread_mutex_lock(&exec_mx);
+    reads.push_back(pending);
+    pthread_cond_broadcast(&exec_cond);
+    pthread_mutex_unlock(&exec_mx);
+    return 0;
+}
+
+/*!****************************************************************************
+ * @brief streamRead Stream device memory back in chunks, straight from 
+ *        device memory. Called by the sender; writes that overlap the read
+ *        and launches that may write there wait until it has been sent.
+ * @param read Read to send
+ * @return 0 on success, -1 if the connection failed
+ * ***************************************************************************/
+int ControlLink::streamRead(PendingRead *read){
+    uint64_t sent = 0;
+    uint64_t chunk;
+    CommPacket_t header;
+    struct iovec iov[2];
+
+    header.version = MORACL_PROTOCOL_VERSION;
+    header.cmdId = MEM_READ_RSP_CMD;
+    header.id = read->id;
+    do{
+        chunk = (read->length - sent > MORACL_CHUNK_SIZE) ? MORACL_CHUNK_SIZE : read->length - sent;
+        header.flags = htons((sent + chunk < read->length) ? MORACL_FLAG_MORE : 0);
+        header.length = htonl(COMM_HEADER_LENGTH + sizeof(MemReadWrite_t) + chunk);
+        header.payload.read.offset = htobe64(read->offset + sent);
+        header.payload.read.accessLength = htobe64(chunk);
+        iov[0].iov_base = &header;
+        iov[0].iov_len = COMM_HEADER_LENGTH + sizeof(MemReadWrite_t);
+        iov[1].iov_base = space->data + read->offset + sent;
+        iov[1].iov_len = chunk;
+        if(sendVector(iov, 2) < 0){
             perror("[CTRL] Unable to send data read response.");
-            close(connfd);
-            pthread_exit(NULL);
+            return -1;
         }
-        sentLen += wcount;
-    }
-    fprintf(stderr, "[DATA] Sending requested data complete.\n");
+        sent += chunk;
+    }while(sent < read->length);
+    DEBUG("%s: Sending requested data complete.\n", __func__);
     return 0;  
 }
 
 /*!****************************************************************************
- * @brief handleMemoryWrite Write to device memory
- * @param loadkernel pointer to Load kernel command payload
+ * @brief handleMemoryWrite Write one chunk to device memory
+ * @param write pointer to Memory write command payload
+ * @param flags Packet flags
+ * @param dataLength Data bytes carried by the packet
+ * ***************************************************************************/
+int ControlLink::handleMemoryWrite(MemReadWrite_t *write, uint16_t flags, size_t dataLength){
+    uint64_t offset = be64toh(write->offset);
+    uint64_t accessLength = be64toh(write->accessLength);
+    bool ok = space != NULL && accessLength == dataLength && 
+              memoryRange(offset, accessLength, space->memSize);
+    
+    DEBUG("%s: Off %llx, access %llx\n", __func__, 
+          (unsigned long long)offset, (unsigned long long)accessLength);
+
+    if(ok){
+        pthread_mutex_lock(&(space->data_mx));
+        memcpy(space->data+offset, write->data, accessLength);
+        pthread_mutex_unlock(&(space->data_mx));
+    }else{
+        fprintf(stderr, "[CTRL] Write outside device memory (%zu bytes).\n", parent->memSize);
+    }
+    return finishChunk(flags, ok);
+}
+
+/*!****************************************************************************
+ * @brief startMemoryWrite Take a write whose data is still coming in. The 
+ *        data at hand goes to device memory now, serve reads the rest 
+ *        straight into place. A write that will be refused is left to 
+ *        arrive in full.
+ * @param write pointer to Memory write command payload
+ * @param flags Packet flags
+ * @param dataLength Data bytes the packet carries
+ * @param available Data bytes received so far
+ * @return Bytes consumed from the buffer, 0 if the write waits to be whole
  * ***************************************************************************/
-int ControlLink::handleMemoryWrite(MemReadWrite_t *write){
-    int offset = ntohl(write->offset);
-    int accessLength = ntohl(write->accessLength);
+int ControlLink::startMemoryWrite(MemReadWrite_t *write, uint16_t flags, 
+                                  size_t dataLength, size_t available){
+    uint64_t offset = be64toh(write->offset);
+    uint64_t accessLength = be64toh(write->accessLength);
     
-    fprintf(stderr, "[CTRL] handleMemoryWrite. Off %x, access %x\n", offset, accessLength);
+    if(space == NULL || accessLength != dataLength || 
+       !memoryRange(offset, accessLength, space->memSize)){
+        return 0;
+    }
+    DEBUG("%s: Off %llx, access %llx, %zu bytes at hand\n", __func__, 
+          (unsigned long long)offset, (unsigned long long)accessLength, available);
+    pthread_mutex_lock(&(space->data_mx));
+    memcpy(space->data + offset, write->data, available);
+    pthread_mutex_unlock(&(space->data_mx));
+    inbound = space->data + offset + available;
+    inboundLeft = accessLength - available;
+    inboundFlags = flags;
+    return COMM_HEADER_LENGTH + sizeof(MemReadWrite_t) + available;
+}
 
-    pthread_mutex_lock(&(parent->data_mx));
-    memcpy(parent->data+offset, write->data, accessLength);
-    pthread_mutex_unlock(&(parent->data_mx));
-    fprintf(stderr, "[CTRL] handleMemoryWrite.\n");
+/*!****************************************************************************
+ * @brief handleKernelOffer Make an image the device holds already the 
+ *        session's kernel, saving the host the upload
+ * @param offer pointer to Offer kernel command payload
+ * ***************************************************************************/
+int ControlLink::handleKernelOffer(KernelOffer_t *offer){
+    uint64_t hash = be64toh(offer->hash);
+    LoadedKernel *held = parent->kernels->find(hash, ntohl(offer->size));
     
-    sendAck();
-    fprintf(stderr, "[DATA] Sending ack complete.\n");
-    fprintf(stderr, "offset: %d\n", offset);
-    fprintf(stderr, "memsize: %d, recv end: %d\n", GLOBAL_MEMORY_SIZE, offset + accessLength);
-    return 0;  
+    DEBUG("%s: Kernel %016llx offered, %s.\n", __func__, 
+          (unsigned long long)hash, held ? "held" : "not held");
+    if(held == NULL){
+        return sendErr();
+    }
+    holdKernel(hash, held);
+    return sendAck();
 }
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
+ * @brief handleKernelLoad Load one chunk of the kernel image. The image is 
+ *        gathered in a memory file, loaded from there by a loader thread 
+ *        and kept in the device's image cache. The session holds it from 
+ *        the last chunk on; kernels already queued keep running meanwhile.
  * @param loadkernel pointer to Load kernel command payload
+ * @param flags Packet flags
+ * @param dataLength Data bytes carried by the packet
  * ***************************************************************************/
-int ControlLink::handleKernelLoad(LoadKernel_t *loadkernel){
+int ControlLink::handleKernelLoad(LoadKernel_t *loadkernel, uint16_t flags, size_t dataLength){
     
-    int dataSize = ntohl(loadkernel->dataSize);
-    int kernelSize = ntohl(loadkernel->totalSize);
-    int offset = ntohl(loadkernel->offset);
+    size_t dataSize = ntohl(loadkernel->dataSize);
+    size_t kernelSize = ntohl(loadkernel->totalSize);
+    size_t offset = ntohl(loadkernel->offset);
+    uint64_t hash = be64toh(loadkernel->hash);
+    bool ok = dataSize == dataLength;
+    ssize_t written;
+    size_t done;
     
-    DEBUG("%s: Load Kernel %d bytes at %d of %d.\n", __func__, 
+    DEBUG("%s: Load Kernel %zd bytes at %zd of %zd.\n", __func__, 
                                                     dataSize, 
                                                     offset, 
                                                     kernelSize);
     
-    //Any Kernel loading will invalidate current kernel
-    kernelValid = false;
-    
-    if(offset == 0){
+    if(ok && offset == 0){
         //Start of file
-        if(kernelfd != NULL){
-            fclose(kernelfd);
-            kernelfd = NULL;
+        if(imagefd >= 0){
+            close(imagefd);
         }
-        kernelfd = fopen("kernel.so", "wb+");
+        imagefd = memfd_create("kernel", MFD_CLOEXEC);
+        imageSum = IMAGE_HASH_INIT;
     }
     
-    if(kernelfd == NULL){
-        fprintf(stderr, "[CTRL] Cannot open kernel file.\n");
-        sendErr();
+    if(ok && imagefd < 0){
+        perror("[CTRL] Cannot create kernel file");
+        ok = false;
     }
     
-    if(dataSize != fwrite(loadkernel->data, 1, dataSize, kernelfd)){
-        fprintf(stderr, "[CTRL] Kernel write error.\n");
-        fclose(kernelfd);
-        kernelfd = NULL;
-        sendErr();
+    if(ok && offset + dataSize > kernelSize){
+        fprintf(stderr, "[CTRL] Received too many kernel bytes.\n");
+        ok = false;
     }
     
-    if(offset + dataSize > kernelSize){
-        fprintf(stderr, "[CTRL] Received too many kernel bytes.\n");
-        fclose(kernelfd);
-        kernelfd = NULL;
-        sendErr();
+    for(done = 0; ok && done < dataSize; done += written){
+        written = pwrite(imagefd, loadkernel->data + done, dataSize - done, offset + done);
+        if(written < 0 && errno == EINTR){
+            written = 0;
+        }else if(written <= 0){
+            perror("[CTRL] Kernel write error");
+            ok = false;
+        }
+    }
+    if(ok){
+        imageSum = imageHash(imageSum, loadkernel->data, dataSize);
+    }
+    
+    if(!ok && imagefd >= 0){
+        close(imagefd);
+        imagefd = -1;
     }
     
-    if(offset + dataSize == kernelSize){
+    if(ok && offset + dataSize == kernelSize){
         fprintf(stderr, "[CTRL] Full kernel received.\n");
-        fclose(kernelfd);
-        kernelfd = NULL;
-        kernelValid = true;
+        /*! A wrong hash would put the image in the cache under another 
+         *  image's name */
+        if(imageSum != hash){
+            fprintf(stderr, "[CTRL] Kernel image does not match its hash.\n");
+            close(imagefd);
+            imagefd = -1;
+            ok = false;
+        }else{
+            /*! Loaded once, every launch after this reuses the image. 
+             *  mustWait held this chunk back while another upload loaded. */
+            loading = new ImageLoad;
+            loading->fd = imagefd;
+            loading->hash = hash;
+            loading->size = kernelSize;
+            loading->id = requestId;
+            loading->kernel = NULL;
+            loading->done = false;
+            imagefd = -1;
+            if(pthread_create(&(loading->thread), NULL, load_thread_start, this) == 0){
+                holdKernel(hash, NULL);
+                return 0;
+            }
+            perror("[CTRL] Unable to start kernel loader");
+            close(loading->fd);
+            delete loading;
+            loading = NULL;
+            ok = false;
+        }
     }
     
-    sendAck();
+    return finishChunk(flags, ok);
+}
+
+/*!****************************************************************************
+ * @brief handleLaunch Queue a kernel the session holds to run over a work 
+ *        size with the launch's arguments. The launch is acked once it is 
+ *        queued; the executor reports when it has run.
+ * @param launch pointer to Launch kernel command payload
+ * @param payloadLength Bytes of payload carried by the packet
+ * ***************************************************************************/
+int ControlLink::handleLaunch(LaunchKernel_t *launch, size_t payloadLength){
+    uint64_t received = deviceClock();
+    size_t argSize = ntohl(launch->argSize);
+    size_t rangeCount = ntohl(launch->rangeCount);
+    PendingLaunch *pending;
+    MemRange_t range;
+    MemRange memRange;
+    std::map<uint64_t, ResidentKernel>::iterator it = resident.find(be64toh(launch->kernel));
+    LoadedKernel *kernel = (it != resident.end()) ? it->second.kernel : NULL;
+    size_t i;
     
+    /*! Used, as far as the host's count goes, even if refused */
+    if(kernel != NULL){
+        it->second.lastUse = ++kernelClock;
+    }
+    if(kernel == NULL || space == NULL || argSize > MORACL_ARG_BLOCK_SIZE || 
+       rangeCount > MORACL_MAX_RANGES ||
+       payloadLength != sizeof(LaunchKernel_t) + argSize + rangeCount * sizeof(MemRange_t)){
+        fprintf(stderr, "[CTRL] Cannot launch, %s.\n", 
+                kernel ? (space ? "bad argument block" : "no context") : "kernel not held");
+        return sendErr();
+    }
+    pending = new PendingLaunch;
+    pending->received = received;
+    pending->id = requestId;
+    pending->kernel = kernel;
+    parent->kernels->retain(kernel);
+    pending->work.entry = kernel->entry;
+    pending->work.globalSize[0] = ntohl(launch->globalWorkSize.globalX);
+    pending->work.globalSize[1] = ntohl(launch->globalWorkSize.globalY);
+    pending->work.globalSize[2] = ntohl(launch->globalWorkSize.globalZ);
+    pending->work.globalOffset[0] = ntohl(launch->globalWorkOffset.globalX);
+    pending->work.globalOffset[1] = ntohl(launch->globalWorkOffset.globalY);
+    pending->work.globalOffset[2] = ntohl(launch->globalWorkOffset.globalZ);
+    /*! The packet sits unaligned in the receive buffer */
+    memcpy(pending->args, launch->args, argSize);
+    pending->work.args = pending->args;
+    pending->work.data = space->data;
+    for(i = 0; i < rangeCount; i++){
+        memcpy(&range, launch->args + argSize + i * sizeof(MemRange_t), sizeof(range));
+        memRange.start = be64toh(range.offset);
+        memRange.end = memRange.start + be64toh(range.length);
+        memRange.write = ntohl(range.flags) & MORACL_RANGE_WRITE;
+        pending->ranges.push_back(memRange);
+    }
+    DEBUG("%s: Queue kernel X:%u, Y %u, Z %u, %zd argument bytes, %zd ranges\n", __func__, 
+          pending->work.globalSize[0], pending->work.globalSize[1], 
+          pending->work.globalSize[2], argSize, rangeCount);
+    
+    /*! Acked before the executor can see it, so the ack always comes 
+     *  before the launch's KERNEL_DONE */
+    if(sendAck() < 0){
+        parent->kernels->release(pending->kernel);
+        delete pending;
+        shutdown(connfd, SHUT_RDWR);
+        return -1;
+    }
+    /*! mustWait kept the packet back while the queue was full */
+    pthread_mutex_lock(&exec_mx);
+    launches.push_back(pending);
+    pthread_cond_broadcast(&exec_cond);
+    pthread_mutex_unlock(&exec_mx);
     return 0;  
 }
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief overlapsLaunch Check an access against the queued launches. Must be
+ *        called with exec_mx held.
+ * @param write Whether the access writes; reads only clash with ranges a 
+ *        kernel may write
  * ***************************************************************************/
-int ControlLink::handleStartProcessing(){
+bool ControlLink::overlapsLaunch(uint64_t offset, uint64_t length, bool write){
+    std::deque<PendingLaunch *>::iterator it;
+    size_t i;
     
-     if(kernelValid){
-        DEBUG("%s: Run kernel!\n", __func__);
-        parent->scheduler->addWork(parent->groupSize);
-        if(sendAck() < 0){
-            perror("[CTRL] Unable to ack");
-            close(connfd);
-            pthread_exit(NULL);
+    for(it = launches.begin(); it != launches.end(); it++){
+        for(i = 0; i < (*it)->ranges.size(); i++){
+            if((write || (*it)->ranges[i].write) && 
+               offset < (*it)->ranges[i].end && (*it)->ranges[i].start < offset + length){
+                return true;
+            }
         }
     }
+    return false;
+}
+
+/*!****************************************************************************
+ * @brief overlapsRead Check an access that writes against the reads still 
+ *        to be sent. Must be called with exec_mx held.
+ * ***************************************************************************/
+bool ControlLink::overlapsRead(uint64_t offset, uint64_t length){
+    std::deque<PendingRead>::iterator it;
     
-    return 0;  
+    for(it = reads.begin(); it != reads.end(); it++){
+        if(offset < it->offset + it->length && it->offset < offset + length){
+            return true;
+        }
+    }
+    return false;
 }
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief launchOverlapsRead Check the ranges a launch may write against the
+ *        reads still to be sent. A launch handleLaunch refuses never waits.
+ *        Must be called with exec_mx held.
+ * @param launch Launch at the head of the buffer, possibly unaligned
+ * @param payloadLength Bytes of payload carried by the packet
  * ***************************************************************************/
-int ControlLink::handleGlobalWorkSize(GlobalWorkSize_t *globalWS){
-    int globalX = ntohl(globalWS->globalX);
-    int globalY = ntohl(globalWS->globalY);
-    int globalZ = ntohl(globalWS->globalZ);
-    DEBUG("%s: Global ws X:%d, Y %d, Z %d\n", __func__, globalX, globalY, globalZ);
-    parent->groupSize[0] = globalX;
-    parent->groupSize[1] = globalY;
-    parent->groupSize[2] = globalZ;
-    sendAck();
-    return 0;  
+bool ControlLink::launchOverlapsRead(LaunchKernel_t *launch, size_t payloadLength){
+    size_t argSize = ntohl(launch->argSize);
+    size_t rangeCount = ntohl(launch->rangeCount);
+    MemRange_t range;
+    size_t i;
+    
+    if(reads.empty() || argSize > MORACL_ARG_BLOCK_SIZE || rangeCount > MORACL_MAX_RANGES ||
+       payloadLength != sizeof(LaunchKernel_t) + argSize + rangeCount * sizeof(MemRange_t)){
+        return false;
+    }
+    for(i = 0; i < rangeCount; i++){
+        memcpy(&range, launch->args + argSize + i * sizeof(MemRange_t), sizeof(range));
+        if((ntohl(range.flags) & MORACL_RANGE_WRITE) && 
+           overlapsRead(be64toh(range.offset), be64toh(range.length))){
+            return true;
+        }
+    }
+    return false;
 }
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief mustWait Check whether a packet has to wait for the executor: a 
+ *        memory access a queued launch touches, or a launch while the queue 
+ *        is full. The session is then parked until a launch is done; 
+ *        accesses elsewhere go ahead at once. Launches of an image still 
+ *        loading, the last chunk of another upload and resets wait for the
+ *        loader the same way, and writes to memory a queued read still has
+ *        to send, or reads while that queue is full, for the sender.
+ * @param packet Complete packet at the head of the buffer
+ * @param payloadLength Bytes of payload carried by the packet
  * ***************************************************************************/
-int ControlLink::sendAck(){
-  /* send ack */
-  char ackBuf[4];
-  CommPacket_t *ack = (CommPacket_t *)ackBuf;
-  int len = 4;
-  ack->version = MORACL_PROTOCOL_VERSION;
-  ack->cmdId = CTRL_ACK;
-  ack->length = htons(len);
-  
-  if(len != send(connfd, ackBuf, len, 0)){
-        perror("[CTRL] Unable to send ack");
-  }
+bool ControlLink::mustWait(CommPacket_t *packet, size_t payloadLength){
+    bool wait = false;
+    
+    std::map<uint64_t, ResidentKernel>::iterator it;
+    
+    pthread_mutex_lock(&exec_mx);
+    reapLoad();
+    switch(packet->cmdId){
+        case MEM_READ_CMD:
+            wait = reads.size() >= SEND_QUEUE_DEPTH;
+            if(!wait && payloadLength >= sizeof(MemReadWrite_t)){
+                wait = overlapsLaunch(be64toh(packet->payload.read.offset), 
+                                      be64toh(packet->payload.read.accessLength), false);
+            }
+            break;
+        case MEM_WRITE_CMD:
+            if(payloadLength >= sizeof(MemReadWrite_t)){
+                wait = overlapsLaunch(be64toh(packet->payload.write.offset), 
+                                      be64toh(packet->payload.write.accessLength), true) || 
+                       overlapsRead(be64toh(packet->payload.write.offset), 
+                                    be64toh(packet->payload.write.accessLength));
+            }
+            break;
+        case LAUNCH_KERNEL:
+            wait = launches.size() >= EXEC_QUEUE_DEPTH;
+            if(!wait && payloadLength >= sizeof(LaunchKernel_t)){
+                it = resident.find(be64toh(packet->payload.launch.kernel));
+                wait = (it != resident.end() && it->second.kernel == NULL) || 
+                       launchOverlapsRead(&(packet->payload.launch), payloadLength);
+            }
+            break;
+        case LOAD_KERNEL_IMAGE:
+            wait = loading != NULL && !(ntohs(packet->flags) & MORACL_FLAG_MORE);
+            break;
+        case RESET:
+            wait = loading != NULL;
+            break;
+    }
+    parked = wait;
+    pthread_mutex_unlock(&exec_mx);
+    return wait;
 }
 
 /*!****************************************************************************
- * @brief handleKernelLoad Load parts of the kernel
- * @param loadkernel pointer to Load kernel command payload
+ * @brief Start of the executor thread, required for pthread
  * ***************************************************************************/
-int ControlLink::sendErr(){
-  /* send nak */
-  char nakBuf[4];
-  CommPacket_t *nak = (CommPacket_t *)nakBuf;
-  int len = 4;
-  nak->version = MORACL_PROTOCOL_VERSION;
-  nak->cmdId = CTRL_NAK;
-  nak->length = htons(len);
+void* ControlLink::exec_thread_start(void *arg){
+    return ((ControlLink *)arg)->exec_thread();
+}
+
+/*!****************************************************************************
+ * @brief exec_thread Run the session's launches in the order they came. 
+ *        Launches still queued when the host goes away are dropped. A 
+ *        parked session is handed back to the listener as each launch is 
+ *        done, and the listener is told when the session has finished,
+ *        which takes the sender to have exited as well.
+ * ***************************************************************************/
+void* ControlLink::exec_thread(){
+    PendingLaunch *pending;
+    uint64_t start, end;
+    bool run;
+    
+    pthread_mutex_lock(&exec_mx);
+    while(1){
+        while(launches.empty() && !stopping){
+            pthread_cond_wait(&exec_cond, &exec_mx);
+        }
+        if(launches.empty()){
+            break;
+        }
+        pending = launches.front();
+        run = !stopping;
+        pthread_mutex_unlock(&exec_mx);
+        
+        if(run){
+            start = deviceClock();
+            if(pending->work.globalSize[0] && pending->work.globalSize[1] && 
+               pending->work.globalSize[2]){
+                parent->scheduler->addWork(&(pending->work));
+            }
+            end = deviceClock();
+            if(sendDone(pending->id, 0, pending->received, start, end) < 0){
+                perror("[CTRL] Unable to report kernel done");
+                shutdown(connfd, SHUT_RDWR);
+            }
+        }
+        
+        pthread_mutex_lock(&exec_mx);
+        launches.pop_front();
+        if(parked){
+            parent->controller->wake();
+        }
+        pthread_mutex_unlock(&exec_mx);
+        parent->kernels->release(pending->kernel);
+        delete pending;
+        pthread_mutex_lock(&exec_mx);
+    }
+    pthread_mutex_unlock(&exec_mx);
+    pthread_join(sender, NULL);
+    __atomic_store_n(&finished, true, __ATOMIC_RELEASE);
+    parent->controller->wake();
+    return NULL;
+}
+
+/*!****************************************************************************
+ * @brief Start of the sender thread, required for pthread
+ * ***************************************************************************/
+void* ControlLink::send_thread_start(void *arg){
+    return ((ControlLink *)arg)->send_thread();
+}
+
+/*!****************************************************************************
+ * @brief send_thread Stream the session's reads back in the order they 
+ *        came. Blocking on a host that is slow to take them only holds up
+ *        this session; a session parked on a read is handed back to the 
+ *        listener as each one has been sent.
+ * ***************************************************************************/
+void* ControlLink::send_thread(){
+    PendingRead read;
+    
+    pthread_mutex_lock(&exec_mx);
+    while(1){
+        while(reads.empty() && !stopping){
+            pthread_cond_wait(&exec_cond, &exec_mx);
+        }
+        if(stopping){
+            break;
+        }
+        read = reads.front();
+        pthread_mutex_unlock(&exec_mx);
+        
+        if(streamRead(&read) < 0){
+            /* Ends the receive loop, which cleans up the session */
+            shutdown(connfd, SHUT_RDWR);
+        }
+        
+        pthread_mutex_lock(&exec_mx);
+        reads.pop_front();
+        if(parked){
+            parent->controller->wake();
+        }
+    }
+    reads.clear();
+    pthread_mutex_unlock(&exec_mx);
+    return NULL;
+}
+
+/*!****************************************************************************
+ * @brief sendStatus Answer a request with ACK or NAK
+ * @param cmdId CTRL_ACK or CTRL_NAK
+ * @param id Request id, as sent
+ * ***************************************************************************/
+int ControlLink::sendStatus(uint8_t cmdId, uint32_t id){
+  char statusBuf[COMM_HEADER_LENGTH];
+  CommPacket_t *status = (CommPacket_t *)statusBuf;
+  int len = COMM_HEADER_LENGTH;
+  status->version = MORACL_PROTOCOL_VERSION;
+  status->cmdId = cmdId;
+  status->flags = 0;
+  status->id = id;
+  status->length = htonl(len);
   
-  if(len != send(connfd, nakBuf, len, 0)){
-        perror("[CTRL] Unable to send nak");
+  if(sendPacket(statusBuf, len) < 0){
+        perror((cmdId == CTRL_ACK) ? "[CTRL] Unable to send ack" : "[CTRL] Unable to send nak");
+        return -1;
   }
+  return 0;
 }
 
+/*!****************************************************************************
+ * @brief sendAck Accept the request being handled
+ * ***************************************************************************/
+int ControlLink::sendAck(){
+  return sendStatus(CTRL_ACK, requestId);
+}
 
+/*!****************************************************************************
+ * @brief sendDone Report that a launch has run, and when
+ * @param id Request id of the launch, as sent
+ * @param status 0 if the kernel ran
+ * @param received time the launch arrived, device clock in ns
+ * @param start time the kernel started
+ * @param end time the kernel finished
+ * ***************************************************************************/
+int ControlLink::sendDone(uint32_t id, uint32_t status, uint64_t received, uint64_t start, uint64_t end){
+  CommPacket_t done;
+  int len = COMM_HEADER_LENGTH + sizeof(KernelDone_t);
+  done.version = MORACL_PROTOCOL_VERSION;
+  done.cmdId = KERNEL_DONE;
+  done.flags = 0;
+  done.id = id;
+  done.length = htonl(len);
+  done.payload.done.status = htonl(status);
+  done.payload.done.timing.received = htobe64(received);
+  done.payload.done.timing.start = htobe64(start);
+  done.payload.done.timing.end = htobe64(end);
+  done.payload.done.timing.sent = htobe64(deviceClock());
+  
+  return sendPacket(&done, len);
+}
 
+/*!****************************************************************************
+ * @brief sendErr Refuse the request being handled
+ * ***************************************************************************/
+int ControlLink::sendErr(){
+  return sendStatus(CTRL_NAK, requestId);
+}
@@ -11,33 +11,102 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <sys/uio.h>
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <vector>
 
 #include "SocketConnector.hpp"
 #include "Device.hpp"
 #include "ComputeUnit.hpp"
+#include "RingBuffer.hpp"
 
 
 #define PACKED_STRUCT __attribute__((packed))
-#define MORACL_PROTOCOL_VERSION 1
+#define MORACL_PROTOCOL_VERSION 7
 
 #define RESET                   0x00
 #define MEM_WRITE_CMD           0x01
 #define MEM_READ_CMD            0x02
 #define MEM_READ_RSP_CMD        0x03
 #define LOAD_KERNEL_IMAGE       0x04
-#define START_KERNEL            0x05
-#define GLOBAL_WORK_SIZE        0x06
+#define HELLO                   0x07
+#define LAUNCH_KERNEL           0x08
+#define KERNEL_DONE             0x09
+#define OFFER_KERNEL            0x0A
 
 #define CTRL_ACK                     0xFE
 #define CTRL_NAK                     0xFF
 
+/* Packet flags */
+#define MORACL_FLAG_MORE        0x0001  /* More chunks of this transfer follow, 
+                                           only the last one is answered */
+
+#define COMM_HEADER_LENGTH      12          /* version, cmdId, flags, length, id */
+#define MORACL_CHUNK_SIZE       (32*1024)   /* Largest data chunk in one packet */
+#define MORACL_ARG_BLOCK_SIZE   8192        /* Largest kernel argument block */
+#define MORACL_MAX_RANGES       64          /* Most memory ranges one launch declares */
+#define MORACL_SESSION_KERNELS  16          /* Kernels a session holds, least recently 
+                                               offered, uploaded or launched go first */
+
+/* The device answers with its own version and global memory size. Sessions
+   naming the same context share an address space, one that is dropped with 
+   the context's last session; context 0 gets no memory. */
+typedef struct {
+  uint32_t version;
+  uint64_t memSize;
+  uint64_t context;
+} PACKED_STRUCT Hello_t;
+
 typedef struct {
   uint32_t globalX;
   uint32_t globalY;
   uint32_t globalZ;
 } PACKED_STRUCT GlobalWorkSize_t;
 
+/* Memory range flags */
+#define MORACL_RANGE_WRITE      0x0001  /* The kernel may write to the range */
+
+/* Device memory a kernel may touch */
+typedef struct {
+  uint64_t offset;
+  uint64_t length;
+  uint32_t flags;
+} PACKED_STRUCT MemRange_t;
+
+/* Work size, offset of the first work item and the argument block the 
+   kernel wrapper reads its arguments from. The block is laid out by the host
+   for the wrapper it generated and is passed through untouched, in host byte
+   order. rangeCount MemRange_t follow the block; memory transfers that 
+   overlap them wait for the kernel, others go ahead while it runs. 
+   The launch is acked as soon as it is queued, KERNEL_DONE follows when it 
+   has run. kernel is the hash of a kernel the session holds, offered or 
+   uploaded earlier; a session keeps the MORACL_SESSION_KERNELS it used 
+   last. */
+typedef struct {
+  uint64_t kernel;
+  GlobalWorkSize_t globalWorkSize;
+  GlobalWorkSize_t globalWorkOffset;
+  uint32_t argSize;
+  uint32_t rangeCount;
+  uint8_t args[0];
+} PACKED_STRUCT LaunchKernel_t;
+
+/* A kernel image is offered by its FNV-1a hash and size first. The device
+   ACKs if it holds the image, which the session then holds as well, and 
+   NAKs if it has to be uploaded. Images come from hosts that run code on 
+   the device anyway, the hash only has to tell images apart. */
+typedef struct {
+  uint64_t hash;
+  uint32_t size;
+} PACKED_STRUCT KernelOffer_t;
+
+/* Chunk of a kernel image; the device checks the hash of the whole image.
+   The session holds the image from the last chunk on, launches of it wait
+   while it loads; the last chunk is answered once it has loaded. */
 typedef struct {
+  uint64_t hash;
   uint32_t totalSize;
   uint32_t offset;
   uint32_t dataSize;
@@ -45,30 +114,107 @@ typedef struct {
 } PACKED_STRUCT LoadKernel_t;
 
 typedef struct {
-  uint32_t offset;
-  uint32_t accessLength;
+  uint64_t offset;
+  uint64_t accessLength;
   uint8_t data[0];
 } PACKED_STRUCT MemReadWrite_t;
 
+/* When a kernel ran, device clock in ns */
+typedef struct {
+  uint64_t received;
+  uint64_t start;
+  uint64_t end;
+  uint64_t sent;
+} PACKED_STRUCT KernelTiming_t;
+
+/* Sent for every acked launch once it has run. Status 0 means it ran. */
+typedef struct {
+  uint32_t status;
+  KernelTiming_t timing;
+} PACKED_STRUCT KernelDone_t;
+
+/* All multi-byte fields are big endian, length covers the whole packet. 
+   Every answer carries the id of the request it answers: ACK, NAK and 
+   MEM_READ_RSP that of the request, KERNEL_DONE that of the launch. Answers
+   may come in any order; chunks of one transfer share an id. */
 typedef struct {
   uint8_t version;
-  uint16_t length;
   uint8_t cmdId;
+  uint16_t flags;
+  uint32_t length;
+  uint32_t id;
   union {
     MemReadWrite_t write;
     MemReadWrite_t read;
     LoadKernel_t loadkernel;
-    GlobalWorkSize_t globalWorkSize;
+    KernelOffer_t offer;
+    LaunchKernel_t launch;
+    KernelDone_t done;
+    Hello_t hello;
   } payload;
 } PACKED_STRUCT CommPacket_t;
 
+/* Launches a session queues before it stops reading from the host */
+#define EXEC_QUEUE_DEPTH 64
+/* Reads a session queues to stream back before it stops reading */
+#define SEND_QUEUE_DEPTH 64
+/* Reads from one host before the listener turns to the others */
+#define SESSION_READ_BURST 16
+
+/*! Device memory a launch may touch, [start, end) */
+struct MemRange{
+  uint64_t start;
+  uint64_t end;
+  bool write;
+};
+
+/*! A launch acked to the host, waiting for or running on the executor */
+struct PendingLaunch{
+  KernelLaunch work;
+  LoadedKernel *kernel;                 /*! Reference held until the launch is done */
+  uint64_t received;                    /*! Device clock when the launch arrived */
+  uint32_t id;                          /*! Request id, as sent, for KERNEL_DONE */
+  std::vector<MemRange> ranges;
+  /*! Argument block, aligned for any kernel argument type */
+  char args[MORACL_ARG_BLOCK_SIZE] __attribute__((aligned(16)));
+};
+
+/*! A read acked by streaming it, waiting for or being sent by the sender */
+struct PendingRead{
+  uint64_t offset;
+  uint64_t length;
+  uint32_t id;                          /*! Request id, as sent, for MEM_READ_RSP */
+};
+
+/*! A kernel a session holds, see MORACL_SESSION_KERNELS */
+struct ResidentKernel{
+  LoadedKernel *kernel;                 /*! Reference held, NULL while the image loads */
+  unsigned long lastUse;                /*! Session clock when last offered, uploaded or launched */
+};
+
+/*! An uploaded image, loaded on a thread of its own so that dlopen holds 
+ *  up neither the listener nor the running kernel */
+struct ImageLoad{
+  int fd;                               /*! Memory file holding the image */
+  uint64_t hash;
+  size_t size;
+  uint32_t id;                          /*! Request id of the last chunk, answered once loaded */
+  LoadedKernel *kernel;                 /*! Reference held, NULL if the image cannot be loaded */
+  bool done;
+  pthread_t thread;
+};
+
 enum{
   CTRL_STATE_IDLE,
   CTRL_STATE_RECV_KERNEL,
   CTRL_STATE_PROCESSING,
 };
 
-class ControlLink : public SocketConnector{
+/*! A host connection. The listener's event loop reads and handles its 
+ *  packets; kernels run on an executor thread of the session's own and 
+ *  reads are streamed back by a sender thread, so that a host slow to take
+ *  them holds up no other session. */
+class ControlLink{
   char ctrl;
   int connfd;
   pthread_mutex_t ctrl_mx;
@@ -77,30 +223,90 @@ class ControlLink : public SocketConnector{
   pthread_mutex_t ctrl_condmx;
 
   int ctrlState;
-  int kernelValid;
+  std::map<uint64_t, ResidentKernel> resident;  /*! Kernels the session holds, by image hash */
+  unsigned long kernelClock;
+  ImageLoad *loading;       /*! Last upload while it loads, NULL if none */
   int kernelLength;
   int recievedKernelLength;
   
-  FILE *kernelfd;
+  int imagefd;             /*! Memory file of the image being uploaded, -1 if none */
+  uint64_t imageSum;        /*! Hash of the image bytes received so far */
+  int session;
+  bool transferFailed;     /*! A chunk of the current transfer was rejected */
+  bool finished;           /*! Stopped and the executor has exited */
+  
+  /*! Received bytes not handled yet, starting with a packet */
+  RingBuffer ring;
+  /*! Device memory the rest of a write's data is received into, while 
+   *  inboundLeft is not 0 */
+  char *inbound;
+  size_t inboundLeft;
+  uint16_t inboundFlags;
+  bool parked;             /*! The first packet waits for the executor */
+  uint32_t requestId;      /*! Of the packet being handled, as sent */
+  
+  AddressSpace *space;     /*! Of the host context, from HELLO */
+  
+  /*! Replies come from the receiving thread, the executor and the sender */
+  pthread_mutex_t send_mx;
+  
+  /*! Launches run one after another on the executor thread, the front one 
+   *  is running */
+  pthread_t executor;
+  std::deque<PendingLaunch *> launches;
+  pthread_mutex_t exec_mx;
+  pthread_cond_t exec_cond;             /*! Signalled when launches or reads are queued or the session stops */
+  bool stopping;
+  
+  /*! Reads are streamed one after another on the sender thread, under 
+   *  exec_mx as well; the front one is being sent */
+  pthread_t sender;
+  std::deque<PendingRead> reads;
   
   Device *parent;
   
 private:
     int processPacket(char *packet, size_t buflen);
+    int sendVector(struct iovec *iov, int iovcnt);
+    int finishChunk(uint16_t flags, bool ok);
     int handleReset();
+    int handleHello(Hello_t *hello);
     int handleMemoryRead(MemReadWrite_t *read);
-    int handleMemoryWrite(MemReadWrite_t *write);
-    int handleKernelLoad(LoadKernel_t *loadkernel);
-    int handleStartProcessing();
-    int handleGlobalWorkSize(GlobalWorkSize_t *globalWS);
+    int handleMemoryWrite(MemReadWrite_t *write, uint16_t flags, size_t dataLength);
+    int startMemoryWrite(MemReadWrite_t *write, uint16_t flags, size_t dataLength, size_t available);
+    int handleKernelOffer(KernelOffer_t *offer);
+    int handleKernelLoad(LoadKernel_t *loadkernel, uint16_t flags, size_t dataLength);
+    int handleLaunch(LaunchKernel_t *launch, size_t payloadLength);
+    int processBuffer();
+    bool overlapsLaunch(uint64_t offset, uint64_t length, bool write);
+    bool overlapsRead(uint64_t offset, uint64_t length);
+    bool launchOverlapsRead(LaunchKernel_t *launch, size_t payloadLength);
+    bool mustWait(CommPacket_t *packet, size_t payloadLength);
+    void holdKernel(uint64_t hash, LoadedKernel *kernel);
+    void reapLoad();
+    static void* load_thread_start(void *arg);
+    void* load_thread();
+    static void* exec_thread_start(void *arg);
+    void* exec_thread();
+    static void* send_thread_start(void *arg);
+    void* send_thread();
+    int streamRead(PendingRead *read);
+    int sendPacket(const void *packet, size_t length);
+    int sendStatus(uint8_t cmdId, uint32_t id);
 public:
-    ControlLink(Device *parent);
-    virtual ~ControlLink(){};
+    ControlLink(Device *parent, int connfd, int session);
+    ~ControlLink();
     
-    virtual void* act_func();
+    void start();
+    int serve();
+    void stop();
+    bool isParked();
+    bool isFinished();
+    int fd();
     
     int sendAck();
     int sendErr();
+    int sendDone(uint32_t id, uint32_t status, uint64_t received, uint64_t start, uint64_t end);
     int sendKD();
 };
 
@@ -0,0 +1,186 @@
+/*!****************************************************************************
+ * @file ControlListener.cpp Accepts host connections
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#include "ControlListener.hpp"
+#include "ControlLink.hpp"
+#include "debug.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+
+/*!****************************************************************************
+ * @brief Constructor
+ * @param parent Device the sessions operate on
+ * ***************************************************************************/
+ControlListener::ControlListener(Device *parent){
+    this->parent = parent;
+    this->nextSession = 0;
+    this->epfd = -1;
+    if((this->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0){
+        perror("[CTRL] Unable to create wake up event");
+        throw -1;
+    }
+}
+
+/*!****************************************************************************
+ * @brief Destructor, waits for all sessions to end
+ * ***************************************************************************/
+ControlListener::~ControlListener(){
+    reapSessions(true);
+    close(wakefd);
+}
+
+/*!****************************************************************************
+ * @brief reapSessions Free sessions that have finished
+ * @param all stop and wait for sessions that are still running as well
+ * ***************************************************************************/
+void ControlListener::reapSessions(bool all){
+    std::list<ControlLink *>::iterator it = sessions.begin();
+    
+    while(it != sessions.end()){
+        if(all){
+            (*it)->stop();
+        }
+        if(all || (*it)->isFinished()){
+            delete *it;
+            it = sessions.erase(it);
+            if(parent->report){
+                parent->scheduler->reportUtilisation();
+            }
+        }else{
+            ++it;
+        }
+    }
+}
+
+/*!****************************************************************************
+ * @brief wake Have the event loop look at parked and finished sessions. 
+ *        Called from executor threads.
+ * ***************************************************************************/
+void ControlListener::wake(){
+    uint64_t one = 1;
+    
+    if(write(wakefd, &one, sizeof(one)) < 0 && errno != EAGAIN){
+        perror("[CTRL] Unable to wake listener");
+    }
+}
+
+/*!****************************************************************************
+ * @brief acceptSession Start a session for a new connection
+ * ***************************************************************************/
+void ControlListener::acceptSession(){
+    int connfd;
+    struct sockaddr_in ctrl_addr;
+    socklen_t ctrl_addr_len = sizeof(ctrl_addr);
+    struct epoll_event ev;
+    ControlLink *session;
+    
+    if((connfd = accept(act_fd, (struct sockaddr *) &ctrl_addr, &ctrl_addr_len)) == -1){
+        perror("[CTRL] Unable to connect with interface");
+        return;
+    }
+    try{
+        session = new ControlLink(parent, connfd, nextSession++);
+    }catch(...){
+        close(connfd);
+        return;
+    }
+    session->start();
+    sessions.push_back(session);
+    /*! One shot: a session is not looked at again until it has been served */
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = session;
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, connfd, &ev) < 0){
+        perror("[CTRL] Unable to watch connection");
+        session->stop();
+    }
+    DEBUG("[CTRL] %zu sessions\n", sessions.size());
+}
+
+/*!****************************************************************************
+ * @brief serveSession Let a session handle its input, then watch it again
+ *        unless it is parked or has ended
+ * ***************************************************************************/
+void ControlListener::serveSession(ControlLink *session){
+    struct epoll_event ev;
+    
+    if(session->serve() < 0){
+        /*! Closing the connection takes it out of the epoll set */
+        session->stop();
+        return;
+    }
+    if(!session->isParked()){
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = session;
+        if(epoll_ctl(epfd, EPOLL_CTL_MOD, session->fd(), &ev) < 0){
+            perror("[CTRL] Unable to watch connection");
+            session->stop();
+        }
+    }
+}
+
+/*!****************************************************************************
+ * @brief resumeSessions Serve parked sessions again and free finished ones
+ * ***************************************************************************/
+void ControlListener::resumeSessions(){
+    std::list<ControlLink *>::iterator it;
+    uint64_t count;
+    
+    while(read(wakefd, &count, sizeof(count)) > 0);
+    for(it = sessions.begin(); it != sessions.end(); it++){
+        if((*it)->isParked()){
+            serveSession(*it);
+        }
+    }
+    reapSessions(false);
+}
+
+/*!****************************************************************************
+ * @brief act_func Event loop: accept connections and serve every session 
+ *        whose host has sent something
+ * ***************************************************************************/
+void* ControlListener::act_func(){
+    struct epoll_event ev;
+    struct epoll_event events[LISTENER_EVENTS];
+    int count, i;
+
+    fprintf(stderr, "[CTRL] Listener started\n");
+    if((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+        perror("[CTRL] Unable to create event loop");
+        close(act_fd);
+        return NULL;
+    }
+    /*! NULL marks the listening socket, the listener itself the wake up 
+     *  event, anything else is a session */
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, act_fd, &ev);
+    ev.data.ptr = this;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev);
+    
+    while(1){
+        if((count = epoll_wait(epfd, events, LISTENER_EVENTS, -1)) < 0){
+            if(errno == EINTR)
+                continue;
+            perror("[CTRL] Event loop failed");
+            break;
+        }
+        for(i = 0; i < count; i++){
+            if(events[i].data.ptr == NULL){
+                acceptSession();
+            }else if(events[i].data.ptr == this){
+                resumeSessions();
+            }else{
+                serveSession((ControlLink *)events[i].data.ptr);
+            }
+        }
+    }
+    close(act_fd);
+    close(epfd);
+    epfd = -1;
+    reapSessions(true);
+    fprintf(stderr, "[CTRL] Listener stopped\n");
+    
+    return NULL;
+}
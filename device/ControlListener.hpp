@@ -0,0 +1,40 @@
+/*!****************************************************************************
+ * @file ControlListener.hpp Accepts host connections
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#if !defined(CONTROL_LISTENER_HPP)
+#define CONTROL_LISTENER_HPP
+#include <list>
+
+#include "SocketConnector.hpp"
+#include "Device.hpp"
+
+/* Events taken from epoll at a time */
+#define LISTENER_EVENTS 64
+
+class ControlLink;
+
+/*! Every command queue on the host opens its own connection, which is served
+ *  by a ControlLink session of its own. One event loop reads from all of 
+ *  them; sessions of every host share the compute units. */
+class ControlListener : public SocketConnector{
+  Device *parent;
+  int nextSession;
+  std::list<ControlLink *> sessions;
+  int epfd;
+  int wakefd;                   /*! Executors ask for the loop's attention */
+
+private:
+    void reapSessions(bool all);
+    void acceptSession();
+    void serveSession(ControlLink *session);
+    void resumeSessions();
+public:
+    ControlListener(Device *parent);
+    virtual ~ControlListener();
+    
+    virtual void* act_func();
+    void wake();
+};
+
+#endif //CONTROL_LISTENER_HPP
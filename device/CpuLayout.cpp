@@ -0,0 +1,152 @@
+/*!****************************************************************************
+ * @file CpuLayout.cpp Placement of compute units on CPUs
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#include "CpuLayout.hpp"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* NUMA node numbers looked at, nodes may be numbered sparsely */
+#define CPU_LAYOUT_MAX_NODES 64
+
+/*!****************************************************************************
+ * @brief readNodeCpus Read the CPUs of a NUMA node from sysfs
+ * @param node NUMA node
+ * @param set Returns the node's CPUs
+ * @return false if there is no such node
+ * ***************************************************************************/
+static bool readNodeCpus(int node, cpu_set_t *set){
+    char path[64];
+    char list[4096];
+    char *p, *end;
+    long first, last;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if((f = fopen(path, "r")) == NULL){
+        return false;
+    }
+    if(fgets(list, sizeof(list), f) == NULL){
+        list[0] = '\0';
+    }
+    fclose(f);
+
+    /*! A list of ranges: 0-3,8-11 */
+    CPU_ZERO(set);
+    for(p = list; *p >= '0' && *p <= '9'; p = end + (*end == ',')){
+        first = last = strtol(p, &end, 10);
+        if(*end == '-'){
+            last = strtol(end + 1, &end, 10);
+        }
+        for(; first <= last && first < CPU_SETSIZE; first++){
+            CPU_SET(first, set);
+        }
+    }
+    return true;
+}
+
+/*!****************************************************************************
+ * @brief Constructor, lays out the CPUs the daemon is allowed to run on
+ * @param numaNode Only use the CPUs of this node when pinning, -1 for all
+ * @param pin Give each compute unit a CPU of its own
+ * @param isolate Keep one CPU for the control threads
+ * ***************************************************************************/
+CpuLayout::CpuLayout(int numaNode, bool pin, bool isolate){
+    cpu_set_t allowed, node;
+    int counter, cpu;
+
+    this->pin = pin;
+    this->controlCpu = -1;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) < 0){
+        perror("[DEV] Unable to read CPU affinity");
+        CPU_ZERO(&allowed);
+        for(cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN) && cpu < CPU_SETSIZE; cpu++){
+            CPU_SET(cpu, &allowed);
+        }
+    }
+
+    /*! Node by node, CPUs without a node last */
+    for(counter = 0; counter < CPU_LAYOUT_MAX_NODES; counter++){
+        if(!readNodeCpus(counter, &node) || (pin && numaNode >= 0 && counter != numaNode)){
+            continue;
+        }
+        for(cpu = 0; cpu < CPU_SETSIZE; cpu++){
+            if(CPU_ISSET(cpu, &node) && CPU_ISSET(cpu, &allowed)){
+                this->cpus.push_back(cpu);
+                CPU_CLR(cpu, &allowed);
+            }
+        }
+    }
+    if(this->cpus.empty() || !(pin && numaNode >= 0)){
+        for(cpu = 0; cpu < CPU_SETSIZE; cpu++){
+            if(CPU_ISSET(cpu, &allowed)){
+                this->cpus.push_back(cpu);
+            }
+        }
+    }
+
+    if(isolate && this->cpus.size() > 1){
+        this->controlCpu = this->cpus.front();
+        this->cpus.erase(this->cpus.begin());
+    }
+    DEBUG("%s: %zu CPUs for compute units, control on %d\n", __func__,
+          this->cpus.size(), this->controlCpu);
+}
+
+/*!****************************************************************************
+ * @brief CPUs available to compute units, the default number of them
+ * ***************************************************************************/
+int CpuLayout::size() const{
+    return this->cpus.size();
+}
+
+/*!****************************************************************************
+ * @brief CPU a compute unit is pinned to, -1 if it is not pinned. With more
+ *        compute units than CPUs they are dealt out round robin.
+ * ***************************************************************************/
+int CpuLayout::cpuOf(int designation) const{
+    if(!this->pin || this->cpus.empty()){
+        return -1;
+    }
+    return this->cpus[designation % this->cpus.size()];
+}
+
+/*!****************************************************************************
+ * @brief CPUs a compute unit may run on
+ * @param set Returns the CPUs
+ * @return false if the compute unit can be left where the system puts it
+ * ***************************************************************************/
+bool CpuLayout::unitAffinity(int designation, cpu_set_t *set) const{
+    unsigned int counter;
+
+    if(!this->pin && this->controlCpu < 0){
+        return false;
+    }
+    CPU_ZERO(set);
+    if(this->pin){
+        CPU_SET(this->cpuOf(designation), set);
+    }else{
+        for(counter = 0; counter < this->cpus.size(); counter++){
+            CPU_SET(this->cpus[counter], set);
+        }
+    }
+    return true;
+}
+
+/*!****************************************************************************
+ * @brief Move the calling thread, and the threads it starts later, to the
+ *        control CPU. Compute units set their own affinity.
+ * @return 0 on success or if no CPU is kept for control, -1 on error
+ * ***************************************************************************/
+int CpuLayout::isolateControl() const{
+    cpu_set_t set;
+
+    if(this->controlCpu < 0){
+        return 0;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(this->controlCpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+}
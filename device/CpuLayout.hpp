@@ -0,0 +1,27 @@
+/*!****************************************************************************
+ * @file CpuLayout.hpp Placement of compute units on CPUs Definitions
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#if !defined(CPULAYOUT_HPP)
+#define CPULAYOUT_HPP
+#include <sched.h>
+#include <vector>
+
+/*!
+ * The CPUs compute units run on, taken from the CPUs the daemon may use and
+ * grouped by NUMA node so neighbouring compute units share a node.
+ */
+class CpuLayout{
+    std::vector<int> cpus;              /*! For compute units, in placement order */
+    int controlCpu;                     /*! Kept for the control threads, -1 if shared */
+    bool pin;
+public:
+    CpuLayout(int numaNode, bool pin, bool isolate);
+
+    int size() const;
+    int cpuOf(int designation) const;
+    bool unitAffinity(int designation, cpu_set_t *set) const;
+    int isolateControl() const;
+};
+
+#endif //CPULAYOUT_HPP
@@ -3,17 +3,44 @@
  * @author Jacky H T Luk 2013
  *****************************************************************************/
 #include "Device.hpp"
-#include "ControlLink.hpp"
+#include "ControlListener.hpp"
 #include "TPScheduler.hpp"
+#include "WSScheduler.hpp"
+#include "CpuLayout.hpp"
+#include <stdio.h>
 
 /*!****************************************************************************
  * @brief Constructor
  * @param port The port the device shall listen on.
+ * @param options Memory, scheduler and compute unit settings
  * ***************************************************************************/
-Device::Device(int port){
-    this->data = new char[GLOBAL_MEMORY_SIZE]();
-    this->controller = new ControlLink(this);
-    this->scheduler = new TPScheduler(this->data);
+Device::Device(int port, const DeviceOptions *options){
+    CpuLayout cpus(options->numaNode, options->pin, options->isolate);
+    int computeUnits = options->computeUnits;
+    
+    /*! Spaces are mapped as host contexts arrive; one is tried here so 
+     *  memory settings that cannot work fail at start */
+    delete new AddressSpace(0, options->memSize, options->hugePages, options->numaNode);
+    /*! The control threads are started from this one later on */
+    if(cpus.isolateControl() < 0){
+        perror("[DEV] Unable to move control threads");
+    }
+    if(computeUnits <= 0){
+        computeUnits = (cpus.size() > 0) ? cpus.size() : 1;
+    }
+    this->memSize = options->memSize;
+    this->hugePages = options->hugePages;
+    this->numaNode = options->numaNode;
+    this->report = options->report;
+    printf("Device memory %zu bytes per context, %d compute units\n", this->memSize, computeUnits);
+    pthread_mutex_init(&(this->spaces_mx), NULL);
+    this->controller = new ControlListener(this);
+    this->kernels = new KernelTable();
+    if(options->workStealing){
+        this->scheduler = new WSScheduler(options->rangeItems, computeUnits, &cpus);
+    }else{
+        this->scheduler = new TPScheduler(options->rangeItems, computeUnits, &cpus);
+    }
     this->port = port;
 }
 
@@ -23,7 +50,7 @@ Device::Device(int port){
 Device::~Device(){
     delete this->controller;
     delete this->scheduler;
-    delete this->data;
+    delete this->kernels;
 }
 
 /*!****************************************************************************
@@ -41,29 +68,56 @@ void Device::start(){
 
 /*!****************************************************************************
  * @brief Wait for device thread to complete. This call blocks until the 
- *        device has completed serving one opencl execution.
+ *        listener stops serving hosts.
  * ***************************************************************************/
 void Device::join(){
     this->controller->join();
 }
 
 /*!****************************************************************************
- * @brief Device memory dump.
+ * @brief attach Join a session to the address space of its host context,
+ *        mapping the space for the context's first session
+ * @param key Host context, chosen by the host
+ * @return The space, NULL if no memory could be mapped
  * ***************************************************************************/
-int Device::memdump(){
-    unsigned int len, i;
+AddressSpace *Device::attach(uint64_t key){
+    std::map<uint64_t, AddressSpace *>::iterator it;
+    AddressSpace *space;
+    
+    pthread_mutex_lock(&(this->spaces_mx));
+    it = this->spaces.find(key);
+    if(it != this->spaces.end()){
+        space = it->second;
+    }else{
+        try{
+            space = new AddressSpace(key, this->memSize, this->hugePages, this->numaNode);
+        }catch(...){
+            pthread_mutex_unlock(&(this->spaces_mx));
+            return NULL;
+        }
+        this->spaces[key] = space;
+        fprintf(stderr, "[DEV] Context %016llx attached, %zu contexts\n", 
+                (unsigned long long)key, this->spaces.size());
+    }
+    space->refs++;
+    pthread_mutex_unlock(&(this->spaces_mx));
+    return space;
+}
 
-    pthread_mutex_lock(&data_mx);
-    len = GLOBAL_MEMORY_SIZE;
-    for(i=0; i<len; i++){
-        if(i%16==0) fprintf(stderr, "\n");
-        if(data[i] == '\n')
-            fprintf(stderr, "\\N ");
-        else if(data[i] == '0')
-            fprintf(stderr, ".. ");
-        else
-            fprintf(stderr, "%2x ", data[i]);
+/*!****************************************************************************
+ * @brief detach Leave an address space, unmapping it with the context's 
+ *        last session
+ * ***************************************************************************/
+void Device::detach(AddressSpace *space){
+    if(space == NULL){
+        return;
     }
-    fprintf(stderr, "\n");
-    pthread_mutex_unlock(&data_mx);
-}
\ No newline at end of file
+    pthread_mutex_lock(&(this->spaces_mx));
+    if(--(space->refs) == 0){
+        this->spaces.erase(space->key);
+        fprintf(stderr, "[DEV] Context %016llx released, %zu contexts\n", 
+                (unsigned long long)space->key, this->spaces.size());
+        delete space;
+    }
+    pthread_mutex_unlock(&(this->spaces_mx));
+}
@@ -5,31 +5,52 @@
 #if !defined(DEVICE_HPP)
 #define DEVICE_HPP
 #include "IScheduler.hpp"
+#include "KernelTable.hpp"
+#include "AddressSpace.hpp"
 #include <pthread.h>
 #include <dlfcn.h>
 #include "GlobalDef.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
 
-class ControlLink;
+class ControlListener;
 class ComputeUnit;
 
-
+/*! Settings from the command line */
+struct DeviceOptions{
+  size_t memSize;               /*! Bytes of global memory */
+  bool hugePages;               /*! Back global memory with huge pages where possible */
+  int numaNode;                 /*! Node to bind global memory to, -1 for no binding */
+  unsigned long rangeItems;     /*! Work items per range, 0 to size them per launch */
+  bool workStealing;            /*! Work stealing instead of thread pool scheduler */
+  int computeUnits;             /*! 0 for one per CPU */
+  bool pin;                     /*! Pin each compute unit to a CPU */
+  bool isolate;                 /*! Keep a CPU for the control threads */
+  bool report;                  /*! Report utilisation as sessions end */
+};
 
 class Device{
+  bool hugePages;
+  int numaNode;
+  /*! Address spaces by host context, while sessions use them */
+  std::map<uint64_t, AddressSpace *> spaces;
+  pthread_mutex_t spaces_mx;
   
 public:
-  pthread_mutex_t data_mx;
-  char *data;
+  size_t memSize;
   IScheduler *scheduler;
-  ControlLink *controller;
+  KernelTable *kernels;
+  ControlListener *controller;
   int port;
-  
-  int groupSize[3];
+  bool report;
 
-  Device(int port);
+  Device(int port, const DeviceOptions *options);
   ~Device();
   void start();
   void join();
-  int memdump();
+  AddressSpace *attach(uint64_t key);
+  void detach(AddressSpace *space);
   
 };
 
@@ -5,6 +5,16 @@
 #if !defined(GLOBAL_DEF_HPP)
 #define GLOBAL_DEF_HPP
 
-#define GLOBAL_MEMORY_SIZE 4096
+/* Device memory when no size is given on the command line. The mapping is 
+ * reserved lazily, untouched pages cost nothing. */
+#define GLOBAL_MEMORY_SIZE (256UL << 20)
+/* Huge page size assumed when rounding hugetlb mappings */
+#define HUGE_PAGE_SIZE (2UL << 20)
+/* Most compute units that can be asked for, each runs on its own thread. 
+ * By default there is one per CPU. */
+#define COMPUTE_UNIT_MAX 1024
+/* Kernel images kept loaded after their last launch, for hosts offering 
+ * the same image again */
+#define KERNEL_CACHE_IMAGES 32
 
 #endif //GLOBAL_DEF_HPP
\ No newline at end of file
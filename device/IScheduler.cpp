@@ -0,0 +1,102 @@
+/*!****************************************************************************
+ * @file IScheduler.cpp Scheduler Interface, parts common to all schedulers
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#include "IScheduler.hpp"
+#include "ComputeUnit.hpp"
+#include "CpuLayout.hpp"
+#include <stdio.h>
+
+IScheduler::IScheduler(){
+    pthread_mutex_init(&(this->turn_mx), NULL);
+    pthread_cond_init(&(this->turn_cond), NULL);
+    pthread_mutex_init(&(this->report_mx), NULL);
+    this->ticketNext = 0;
+    this->ticketServing = 0;
+    clock_gettime(CLOCK_MONOTONIC, &(this->lastReport));
+}
+
+IScheduler::~IScheduler(){}
+
+/*!****************************************************************************
+ * @brief The compute units run one kernel at a time, wait for our turn
+ *****************************************************************************/
+void IScheduler::waitTurn(){
+    unsigned long ticket;
+    
+    pthread_mutex_lock(&(this->turn_mx));
+    ticket = this->ticketNext++;
+    while(ticket != this->ticketServing){
+        pthread_cond_wait(&(this->turn_cond), &(this->turn_mx));
+    }
+    pthread_mutex_unlock(&(this->turn_mx));
+}
+
+/*!****************************************************************************
+ * @brief Let the next kernel run
+ *****************************************************************************/
+void IScheduler::endTurn(){
+    pthread_mutex_lock(&(this->turn_mx));
+    this->ticketServing++;
+    pthread_cond_broadcast(&(this->turn_cond));
+    pthread_mutex_unlock(&(this->turn_mx));
+}
+
+/*!****************************************************************************
+ * @brief Create the compute units, designated 0 to count - 1
+ * @param count Compute units
+ * @param cpus Where compute units run
+ *****************************************************************************/
+void IScheduler::createUnits(int count, const CpuLayout *cpus){
+    int counter;
+    
+    for(counter = 0; counter < count; counter++){
+        this->units.push_back(new ComputeUnit(this, counter, cpus));
+    }
+}
+
+/*!****************************************************************************
+ * @brief Delete the compute units
+ *****************************************************************************/
+void IScheduler::deleteUnits(){
+    unsigned int counter;
+    
+    for(counter = 0; counter < this->units.size(); counter++){
+        delete this->units[counter];
+    }
+    this->units.clear();
+}
+
+/*!****************************************************************************
+ * @brief Print how busy each compute unit has been since the last report
+ *****************************************************************************/
+void IScheduler::reportUtilisation(){
+    struct timespec now;
+    unsigned long busyNs, ranges, items;
+    unsigned long totalNs = 0;
+    double window;
+    unsigned int counter;
+    
+    pthread_mutex_lock(&(this->report_mx));
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    window = (now.tv_sec - this->lastReport.tv_sec) * 1e9 + 
+             (now.tv_nsec - this->lastReport.tv_nsec);
+    this->lastReport = now;
+    if(window <= 0){
+        window = 1;
+    }
+    
+    fprintf(stderr, "[DEV] Compute units over the last %.3f s:\n", window / 1e9);
+    for(counter = 0; counter < this->units.size(); counter++){
+        this->units[counter]->takeStats(&busyNs, &ranges, &items);
+        totalNs += busyNs;
+        fprintf(stderr, "[DEV]   cu %3u cpu %3d busy %5.1f%% ranges %lu items %lu\n", 
+                counter, this->units[counter]->cpu, 100.0 * busyNs / window, 
+                ranges, items);
+    }
+    if(!this->units.empty()){
+        fprintf(stderr, "[DEV]   mean busy %5.1f%%\n", 
+                100.0 * totalNs / window / this->units.size());
+    }
+    pthread_mutex_unlock(&(this->report_mx));
+}
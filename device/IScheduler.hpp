@@ -5,14 +5,56 @@
 
 #if !defined(ISCHEDULER_HPP)
 #define ISCHEDULER_HPP
+#include <pthread.h>
+#include <time.h>
+#include <vector>
+
 class ComputeUnit;
+class CpuLayout;
+
+/*! Kernel entry point, runs the work items [begin, end) of a launch */
+typedef void (*pfnKernelWrapper_t)(const unsigned int begin[3], const unsigned int end[3],
+                                   const unsigned int size[3], const unsigned int offset[3],
+                                   void* mem, const void *args);
+
+/*! A kernel launch, valid until addWork returns */
+struct KernelLaunch{
+    pfnKernelWrapper_t entry;           /*! Of a kernel that stays loaded for the launch */
+    unsigned int globalSize[3];
+    unsigned int globalOffset[3];       /*! Global ID of the first work item */
+    const void *args;                   /*! Argument block for the wrapper */
+    char *data;                         /*! Memory of the session's address space */
+};
 
 class IScheduler{
+    /*! Kernels from different sessions take turns in arrival order */
+    unsigned long ticketNext;
+    unsigned long ticketServing;
+    pthread_mutex_t turn_mx;
+    pthread_cond_t turn_cond;
+    
+    pthread_mutex_t report_mx;
+    struct timespec lastReport;
+    
+protected:
+    /*! Every compute unit, indexed by designation */
+    std::vector<ComputeUnit *> units;
+    
+    void createUnits(int count, const CpuLayout *cpus);
+    void deleteUnits();
+    void waitTurn();
+    void endTurn();
     
 public:
     IScheduler();
     
-    virtual void addWork(int globalWS[3]) = 0;
+    void reportUtilisation();
+    
+    virtual void addWork(const KernelLaunch *launch) = 0;
+    
+    /*! Claim the next range of work items, [begin, end) in each dimension.
+     *  Called by compute unit cu until it returns false. */
+    virtual bool nextRange(ComputeUnit *cu, unsigned int begin[3], unsigned int end[3]) = 0;
     
     virtual void CUDone(ComputeUnit *free_cu) = 0;
     
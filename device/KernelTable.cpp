@@ -0,0 +1,183 @@
+/*!****************************************************************************
+ * @file KernelTable.cpp Loaded kernel images
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#include "KernelTable.hpp"
+#include "GlobalDef.hpp"
+#include "debug.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <unistd.h>
+
+KernelTable::KernelTable(){
+    this->nextId = 1;
+    this->clock = 0;
+    pthread_mutex_init(&(this->table_mx), NULL);
+}
+
+/*!****************************************************************************
+ * @brief Destructor, unloads whatever is left
+ *****************************************************************************/
+KernelTable::~KernelTable(){
+    std::map<unsigned long, LoadedKernel *>::iterator it;
+
+    for(it = this->kernels.begin(); it != this->kernels.end(); it++){
+        this->unload(it->second);
+    }
+}
+
+/*!****************************************************************************
+ * @brief Hash image bytes, FNV-1a. The host hashes images the same way.
+ * @param hash IMAGE_HASH_INIT, or the hash of the bytes before these
+ *****************************************************************************/
+uint64_t imageHash(uint64_t hash, const void *data, size_t length){
+    const unsigned char *bytes = (const unsigned char *)data;
+    size_t i;
+
+    for(i = 0; i < length; i++){
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/*!****************************************************************************
+ * @brief Unload an image nobody refers to any more
+ *****************************************************************************/
+void KernelTable::unload(LoadedKernel *kernel){
+    DEBUG("%s: unloading kernel %lu\n", __func__, kernel->id);
+    dlclose(kernel->handle);
+    close(kernel->fd);
+    delete kernel;
+}
+
+/*!****************************************************************************
+ * @brief Drop the cache's references to the images used longest ago, down
+ *        to KERNEL_CACHE_IMAGES. Images no session uses are unloaded. Must
+ *        be called with the table lock held.
+ *****************************************************************************/
+void KernelTable::evict(){
+    std::map<uint64_t, LoadedKernel *>::iterator it, oldest;
+    LoadedKernel *kernel;
+
+    while(this->cache.size() > KERNEL_CACHE_IMAGES){
+        oldest = this->cache.begin();
+        for(it = this->cache.begin(); it != this->cache.end(); it++){
+            if(it->second->lastUse < oldest->second->lastUse){
+                oldest = it;
+            }
+        }
+        kernel = oldest->second;
+        this->cache.erase(oldest);
+        DEBUG("%s: kernel %lu leaves the cache\n", __func__, kernel->id);
+        if(--(kernel->refs) == 0){
+            this->kernels.erase(kernel->id);
+            this->unload(kernel);
+        }
+    }
+}
+
+/*!****************************************************************************
+ * @brief Look an image up by its hash
+ * @param hash Of the image bytes
+ * @param size Image bytes, must match as well
+ * @return The kernel, holding one reference, or NULL if it is not loaded
+ *****************************************************************************/
+LoadedKernel *KernelTable::find(uint64_t hash, size_t size){
+    std::map<uint64_t, LoadedKernel *>::iterator it;
+    LoadedKernel *kernel = NULL;
+
+    pthread_mutex_lock(&(this->table_mx));
+    it = this->cache.find(hash);
+    if(it != this->cache.end() && it->second->size == size){
+        kernel = it->second;
+        kernel->refs++;
+        kernel->lastUse = ++(this->clock);
+    }
+    pthread_mutex_unlock(&(this->table_mx));
+    return kernel;
+}
+
+/*!****************************************************************************
+ * @brief Load a kernel image from a memory file and resolve its entry point.
+ *        dlopen hands back an image already loaded under the same name; the
+ *        name is the file's descriptor, which stays open, and so unused by 
+ *        any other image, as long as the image is loaded. The image goes
+ *        into the cache, unless another session loaded the same one first.
+ * @param fd Memory file holding the image, taken over in any case
+ * @param hash Of the image bytes
+ * @param size Image bytes
+ * @return The kernel, holding one reference, or NULL if it cannot be loaded
+ *****************************************************************************/
+LoadedKernel *KernelTable::load(int fd, uint64_t hash, size_t size){
+    std::map<uint64_t, LoadedKernel *>::iterator it;
+    LoadedKernel *kernel;
+    char path[32];
+    void *handle;
+    void *entry;
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    if((handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL){
+        fprintf(stderr, "[DEV] Cannot load kernel: %s\n", dlerror());
+        close(fd);
+        return NULL;
+    }
+    if((entry = dlsym(handle, "kernel_wrapper")) == NULL){
+        fprintf(stderr, "[DEV] Kernel has no entry point: %s\n", dlerror());
+        dlclose(handle);
+        close(fd);
+        return NULL;
+    }
+
+    kernel = new LoadedKernel;
+    kernel->hash = hash;
+    kernel->size = size;
+    kernel->fd = fd;
+    kernel->handle = handle;
+    kernel->entry = (pfnKernelWrapper_t)entry;
+    kernel->refs = 1;
+    pthread_mutex_lock(&(this->table_mx));
+    kernel->id = this->nextId++;
+    kernel->lastUse = ++(this->clock);
+    this->kernels[kernel->id] = kernel;
+    it = this->cache.find(hash);
+    if(it == this->cache.end()){
+        kernel->refs++;
+        this->cache[hash] = kernel;
+        this->evict();
+    }
+    pthread_mutex_unlock(&(this->table_mx));
+    DEBUG("%s: kernel %lu, %zu bytes, hash %016llx\n", __func__, kernel->id, 
+          size, (unsigned long long)hash);
+    return kernel;
+}
+
+/*!****************************************************************************
+ * @brief Take another reference, keeping the image loaded while it is used
+ *****************************************************************************/
+void KernelTable::retain(LoadedKernel *kernel){
+    pthread_mutex_lock(&(this->table_mx));
+    kernel->refs++;
+    pthread_mutex_unlock(&(this->table_mx));
+}
+
+/*!****************************************************************************
+ * @brief Drop a reference, unloading the image with the last one
+ *****************************************************************************/
+void KernelTable::release(LoadedKernel *kernel){
+    bool unload;
+
+    if(kernel == NULL){
+        return;
+    }
+    pthread_mutex_lock(&(this->table_mx));
+    unload = --(kernel->refs) == 0;
+    if(unload){
+        this->kernels.erase(kernel->id);
+    }
+    pthread_mutex_unlock(&(this->table_mx));
+
+    if(unload){
+        this->unload(kernel);
+    }
+}
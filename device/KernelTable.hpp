@@ -0,0 +1,55 @@
+/*!****************************************************************************
+ * @file KernelTable.hpp Loaded kernel images Definitions
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#if !defined(KERNELTABLE_HPP)
+#define KERNELTABLE_HPP
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+
+#include "IScheduler.hpp"
+
+/*! A kernel image loaded into the device. Its entry point is resolved once
+ *  and shared by every compute unit. */
+struct LoadedKernel{
+    unsigned long id;                   /*! Identity, unique for the device's lifetime */
+    uint64_t hash;                      /*! Of the image bytes, see imageHash */
+    size_t size;                        /*! Image bytes */
+    int fd;                             /*! Memory file the image was loaded from */
+    void *handle;
+    pfnKernelWrapper_t entry;
+    int refs;
+    unsigned long lastUse;              /*! Cache clock when last offered or loaded */
+};
+
+/*! Kernel images loaded by all sessions. An image stays loaded as long as
+ *  someone holds a reference, across any number of launches. The table 
+ *  holds a reference of its own to the KERNEL_CACHE_IMAGES images used 
+ *  last, so a host offering one of those again, from any session, does not
+ *  upload it. */
+class KernelTable{
+    std::map<unsigned long, LoadedKernel *> kernels;
+    std::map<uint64_t, LoadedKernel *> cache;   /*! By image hash */
+    unsigned long nextId;
+    unsigned long clock;
+    pthread_mutex_t table_mx;
+
+    void evict();
+    void unload(LoadedKernel *kernel);
+public:
+    KernelTable();
+    ~KernelTable();
+
+    LoadedKernel *find(uint64_t hash, size_t size);
+    LoadedKernel *load(int fd, uint64_t hash, size_t size);
+    void retain(LoadedKernel *kernel);
+    void release(LoadedKernel *kernel);
+};
+
+/*! FNV-1a over an image, continued from hash; start from IMAGE_HASH_INIT */
+#define IMAGE_HASH_INIT 0xcbf29ce484222325ULL
+uint64_t imageHash(uint64_t hash, const void *data, size_t length);
+
+#endif //KERNELTABLE_HPP
@@ -0,0 +1,86 @@
+/*!****************************************************************************
+ * @file RingBuffer.cpp Receive buffer of a host session
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#include "RingBuffer.hpp"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdio.h>
+
+/*!****************************************************************************
+ * @brief Constructor, maps a memory file twice in a row. Throws if the 
+ *        mappings cannot be had.
+ * @param size Bytes the buffer holds, a multiple of the page size
+ * ***************************************************************************/
+RingBuffer::RingBuffer(size_t size){
+    char *lower, *upper;
+    int fd;
+
+    if((fd = memfd_create("session", MFD_CLOEXEC)) < 0 || ftruncate(fd, size) < 0){
+        perror("[CTRL] Unable to create receive buffer");
+        if(fd >= 0) close(fd);
+        throw -1;
+    }
+    /*! Reserve both halves first, so that the two mappings are adjacent */
+    this->base = (char *)mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(this->base != MAP_FAILED){
+        lower = (char *)mmap(this->base, size, PROT_READ | PROT_WRITE, 
+                             MAP_SHARED | MAP_FIXED, fd, 0);
+        upper = (char *)mmap(this->base + size, size, PROT_READ | PROT_WRITE, 
+                             MAP_SHARED | MAP_FIXED, fd, 0);
+        if(lower == MAP_FAILED || upper == MAP_FAILED){
+            munmap(this->base, 2 * size);
+            this->base = (char *)MAP_FAILED;
+        }
+    }
+    /*! The mappings keep the memory */
+    close(fd);
+    if(this->base == MAP_FAILED){
+        perror("[CTRL] Unable to map receive buffer");
+        throw -1;
+    }
+    this->size = size;
+    this->head = 0;
+    this->count = 0;
+}
+
+RingBuffer::~RingBuffer(){
+    munmap(this->base, 2 * this->size);
+}
+
+/*!****************************************************************************
+ * @brief First byte held, length() bytes follow in one run
+ * ***************************************************************************/
+char *RingBuffer::data(){
+    return this->base + this->head;
+}
+
+size_t RingBuffer::length(){
+    return this->count;
+}
+
+/*!****************************************************************************
+ * @brief Where received bytes go next, room() bytes in one run
+ * ***************************************************************************/
+char *RingBuffer::space(){
+    return this->base + (this->head + this->count) % this->size;
+}
+
+size_t RingBuffer::room(){
+    return this->size - this->count;
+}
+
+/*!****************************************************************************
+ * @brief Drop bytes handled from the front
+ * ***************************************************************************/
+void RingBuffer::consume(size_t bytes){
+    this->head = (this->head + bytes) % this->size;
+    this->count -= bytes;
+}
+
+/*!****************************************************************************
+ * @brief Add bytes received into space()
+ * ***************************************************************************/
+void RingBuffer::fill(size_t bytes){
+    this->count += bytes;
+}
@@ -0,0 +1,32 @@
+/*!****************************************************************************
+ * @file RingBuffer.hpp Receive buffer of a host session Definitions
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#if !defined(RINGBUFFER_HPP)
+#define RINGBUFFER_HPP
+#include <stddef.h>
+
+/*!
+ * Bytes received from a host and not handled yet. The memory is mapped 
+ * twice, back to back, so the bytes held and the room after them are each
+ * one run of memory wherever they start: a packet that wraps around the 
+ * end is read in place, and nothing is moved to make room.
+ */
+class RingBuffer{
+  char *base;
+  size_t size;
+  size_t head;                  /*! Offset of the first byte held */
+  size_t count;                 /*! Bytes held */
+
+public:
+  RingBuffer(size_t size);
+  ~RingBuffer();
+  char *data();
+  size_t length();
+  char *space();
+  size_t room();
+  void consume(size_t bytes);
+  void fill(size_t bytes);
+};
+
+#endif //RINGBUFFER_HPP
@@ -27,8 +27,8 @@ int SocketConnector::init(int port){
         return -1;
     }
 
-    /* listen: backlog = 1 */
-    if(listen(fd, 1) == -1){
+    /* listen: several queues may connect at once */
+    if(listen(fd, LISTEN_BACKLOG) == -1){
         perror("Unable to initiate port listening");
         close(fd);
         return -1;
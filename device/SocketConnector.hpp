@@ -12,6 +12,8 @@
 #include <stdio.h>
 #include <pthread.h>
 #define MAXBUF 64*1024
+/* Connections waiting to be accepted, one per host command queue */
+#define LISTEN_BACKLOG 16
 class SocketConnector{
   pthread_t thread;
 protected:
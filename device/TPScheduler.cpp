@@ -7,76 +7,130 @@
 #include "ComputeUnit.hpp"
 #include "debug.h"
 
-IScheduler::IScheduler(){}
-IScheduler::~IScheduler(){}
-
-TPScheduler::TPScheduler(char *dataPtr){
-    int counter;
+/*!****************************************************************************
+ * @brief Constructor
+ * @param rangeItems Work items a compute unit claims at a time, 0 to cut 
+ *        each launch into RANGES_PER_CU ranges per compute unit
+ * @param computeUnits Compute units in the pool
+ * @param cpus Where compute units run
+ *****************************************************************************/
+TPScheduler::TPScheduler(unsigned long rangeItems, int computeUnits, 
+                         const CpuLayout *cpus){
+    unsigned int counter;
     
+    this->launch = NULL;
+    this->tileCount = 0;
+    this->nextTile = 0;
+    this->rangeItems = rangeItems;
     pthread_mutex_init(&(this->queue_mx), NULL);
-    this->data = dataPtr;
-    for(counter = 0; counter < COMPUTE_UNIT_ARRAY_SIZE; counter++){
-        this->free_cu_array.push(new ComputeUnit(this, counter, this->data));
+    this->createUnits(computeUnits, cpus);
+    for(counter = 0; counter < this->units.size(); counter++){
+        this->free_cu_array.push(this->units[counter]);
     }
-    memset(this->data, 0, GLOBAL_MEMORY_SIZE);
 }
 
 TPScheduler::~TPScheduler(){
-    int counter;
-    for(counter = 0; counter < COMPUTE_UNIT_ARRAY_SIZE; counter++){
-        delete(this->free_cu_array.front());
-        this->free_cu_array.pop();
+    this->deleteUnits();
+}
+    
+/*!****************************************************************************
+ * @brief Cut a launch into tiles. A tile grows along x first, and takes 
+ *        whole rows, then whole planes, once it is larger than one.
+ *****************************************************************************/
+void TPScheduler::planRanges(const KernelLaunch *launch){
+    const unsigned int *size = launch->globalSize;
+    unsigned long row = size[0];
+    unsigned long plane = row * size[1];
+    unsigned long items = this->rangeItems;
+    int i;
+    
+    if(items == 0){
+        items = (plane * size[2]) / (this->units.size() * RANGES_PER_CU);
     }
+    if(items == 0){
+        items = 1;
+    }
+    if(items < row){
+        this->tile[0] = items;
+        this->tile[1] = this->tile[2] = 1;
+    }else if(items < plane){
+        this->tile[0] = size[0];
+        this->tile[1] = items / row;
+        this->tile[2] = 1;
+    }else{
+        this->tile[0] = size[0];
+        this->tile[1] = size[1];
+        this->tile[2] = (items / plane < size[2]) ? items / plane : size[2];
+    }
+    this->tileCount = 1;
+    for(i = 0; i < 3; i++){
+        this->tiles[i] = (size[i] + this->tile[i] - 1) / this->tile[i];
+        this->tileCount *= this->tiles[i];
+    }
+    this->nextTile = 0;
+    this->launch = launch;
+    DEBUG("%s: %lu tiles of %u:%u:%u\n", __func__, this->tileCount, 
+          this->tile[2], this->tile[1], this->tile[0]);
 }
+
+/*!****************************************************************************
+ * @brief Claim the next tile of the current launch
+ * @return false once every tile has been claimed
+ *****************************************************************************/
+bool TPScheduler::nextRange(ComputeUnit *, unsigned int begin[3], unsigned int end[3]){
+    unsigned long index = __atomic_fetch_add(&(this->nextTile), 1, __ATOMIC_RELAXED);
+    unsigned int pos[3];
+    int i;
     
-void TPScheduler::addWork(int globalWS[3]){
+    if(index >= this->tileCount){
+        return false;
+    }
+    pos[0] = index % this->tiles[0];
+    index /= this->tiles[0];
+    pos[1] = index % this->tiles[1];
+    pos[2] = index / this->tiles[1];
+    for(i = 0; i < 3; i++){
+        begin[i] = pos[i] * this->tile[i];
+        end[i] = begin[i] + this->tile[i];
+        if(end[i] > this->launch->globalSize[i]){
+            end[i] = this->launch->globalSize[i];
+        }
+    }
+    return true;
+}
+
+/*!****************************************************************************
+ * @brief Run a kernel over an NDRange. Compute units claim tiles of work 
+ *        items from planRanges, so the scheduler only wakes each of them once.
+ * @param launch Kernel, work size and arguments
+ *****************************************************************************/
+void TPScheduler::addWork(const KernelLaunch *launch){
     int x; 
-    int y;
-    int z;
-    int counter;
+    unsigned long counter;
+    unsigned long workers;
     ComputeUnit *tmp;
     
-    for(counter = 0; counter < COMPUTE_UNIT_ARRAY_SIZE; counter++){
+    this->waitTurn();
+    this->planRanges(launch);
+    
+    /*! Every compute unit is free here, there is no point waking more 
+     *  of them than there are tiles */
+    workers = (this->tileCount < this->units.size()) ? this->tileCount : this->units.size();
+    for(counter = 0; counter < workers; counter++){
+        pthread_mutex_lock(&(this->queue_mx));
         tmp = this->free_cu_array.front();
         this->free_cu_array.pop();
-        tmp->set_kernel((char *)"./kernel.so");
-        this->free_cu_array.push(tmp);
-    }
-    
-    for(z = 0; z < globalWS[2]; z++){
-        for(y = 0; y < globalWS[1]; y++){
-            for(x = 0; x < globalWS[0]; x++){
-                while(1){
-                    pthread_mutex_lock(&(this->queue_mx));
-                    if(false == this->free_cu_array.empty()){
-                        ComputeUnit *free_cu = this->free_cu_array.front();
-                        this->free_cu_array.pop();
-                        pthread_mutex_unlock(&(this->queue_mx));
-                        free_cu->run_kernel(z, y, x);
-                        break;
-                    }else{
-#if !defined(ENABLE_THREAD_POOL)
-                        while(false == this->done_cu_array.empty()){
-                            tmp = this->done_cu_array.front();
-                            this->done_cu_array.pop();
-                            tmp->join();
-                            this->free_cu_array.push(tmp);
-                        }
-#endif
-                        pthread_mutex_unlock(&(this->queue_mx));
-                    }
-                }
-            }
-        }
+        pthread_mutex_unlock(&(this->queue_mx));
+        tmp->run_kernel(launch);
     }
     
     //Finally ensure all threads are joined.
     while(1){
         pthread_mutex_lock(&(this->queue_mx));
 #if defined(ENABLE_THREAD_POOL)
-        if(this->free_cu_array.size() != COMPUTE_UNIT_ARRAY_SIZE){
+        if(this->free_cu_array.size() != this->units.size()){
 #else
-        if(this->free_cu_array.size() + this->done_cu_array.size() != COMPUTE_UNIT_ARRAY_SIZE){
+        if(this->free_cu_array.size() + this->done_cu_array.size() != this->units.size()){
 #endif
             usleep(10);
             pthread_mutex_unlock(&(this->queue_mx));
@@ -94,17 +148,12 @@ void TPScheduler::addWork(int globalWS[3]){
         }
     }
     
-    for(counter = 0; counter < COMPUTE_UNIT_ARRAY_SIZE; counter++){
-        tmp = this->free_cu_array.front();
-        this->free_cu_array.pop();
-        tmp->unset_kernel();
-        this->free_cu_array.push(tmp);
-    }
-
     for(x = 0; x < 128; x++){
-        DEBUG("%d ", ((int *)(this->data))[x]);
+        DEBUG("%d ", ((int *)(launch->data))[x]);
     }
     DEBUG("\n");
+    
+    this->endTurn();
 }
 
 void TPScheduler::CUDone(ComputeUnit *free_cu){
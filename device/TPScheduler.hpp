@@ -11,19 +11,30 @@
 #include <queue>
 #include <deque>
 
-#define COMPUTE_UNIT_ARRAY_SIZE 128
+/* Ranges per compute unit when the range size is left to the scheduler, 
+ * enough to even out uneven work items without much claiming */
+#define RANGES_PER_CU 4
 
 class TPScheduler: public IScheduler{
-    int globalWS[3];
+    /*! The launch is cut into tiles of tile[] work items, tiles[] of them in
+     *  each dimension; compute units claim them by index */
+    const KernelLaunch *launch;
+    unsigned int tile[3];
+    unsigned int tiles[3];
+    unsigned long tileCount;
+    unsigned long nextTile;
+    unsigned long rangeItems;           /*! Work items per range, 0 to size adaptively */
     std::queue<ComputeUnit *> free_cu_array;
     std::queue<ComputeUnit *> done_cu_array;
     pthread_mutex_t queue_mx;
-    char *data;
+    void planRanges(const KernelLaunch *launch);
 public:
     
-    TPScheduler(char *dataPtr);
+    TPScheduler(unsigned long rangeItems, int computeUnits, const CpuLayout *cpus);
     
-    void addWork(int globalWS[3]);
+    void addWork(const KernelLaunch *launch);
+    
+    bool nextRange(ComputeUnit *cu, unsigned int begin[3], unsigned int end[3]);
     
      void CUDone(ComputeUnit *free_cu);
     
@@ -0,0 +1,307 @@
+/*!****************************************************************************
+ * @file WSScheduler.cpp Work stealing scheduler Implementation
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#include "WSScheduler.hpp"
+#include "ComputeUnit.hpp"
+#include "debug.h"
+#include <sched.h>
+
+/*!****************************************************************************
+ * @brief Empty deque
+ *****************************************************************************/
+RangeDeque::RangeDeque(){
+    this->top = 0;
+    this->bottom = 0;
+}
+
+/*!****************************************************************************
+ * @brief Add a range at the bottom. Owner only.
+ * @return false if the deque is full
+ *****************************************************************************/
+bool RangeDeque::push(const WorkRange *range){
+    long b = __atomic_load_n(&(this->bottom), __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&(this->top), __ATOMIC_ACQUIRE);
+
+    if(b - t >= WS_DEQUE_SIZE){
+        return false;
+    }
+    this->ranges[b % WS_DEQUE_SIZE] = *range;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&(this->bottom), b + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/*!****************************************************************************
+ * @brief Remove the range at the bottom. Owner only; races thieves for the
+ *        last range.
+ * @return false if the deque is empty
+ *****************************************************************************/
+bool RangeDeque::take(WorkRange *range){
+    long b = __atomic_load_n(&(this->bottom), __ATOMIC_RELAXED) - 1;
+    long t;
+    bool taken = true;
+
+    __atomic_store_n(&(this->bottom), b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&(this->top), __ATOMIC_RELAXED);
+    if(t > b){
+        __atomic_store_n(&(this->bottom), b + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    *range = this->ranges[b % WS_DEQUE_SIZE];
+    if(t == b){
+        taken = __atomic_compare_exchange_n(&(this->top), &t, t + 1, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&(this->bottom), b + 1, __ATOMIC_RELAXED);
+    }
+    return taken;
+}
+
+/*!****************************************************************************
+ * @brief Remove the range at the top. Any compute unit.
+ * @return false if the deque is empty or another thread got the range first
+ *****************************************************************************/
+bool RangeDeque::steal(WorkRange *range){
+    long t = __atomic_load_n(&(this->top), __ATOMIC_ACQUIRE);
+    long b;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&(this->bottom), __ATOMIC_ACQUIRE);
+    if(t >= b){
+        return false;
+    }
+    /*! The slot cannot be reused before top moves on, the CAS tells
+     *  whether the copy is ours */
+    *range = this->ranges[t % WS_DEQUE_SIZE];
+    return __atomic_compare_exchange_n(&(this->top), &t, t + 1, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/*!****************************************************************************
+ * @brief Constructor
+ * @param rangeItems Smallest range a compute unit runs, 0 to size it from
+ *        each launch
+ * @param computeUnits Compute units taking part in launches
+ * @param cpus Where compute units run
+ *****************************************************************************/
+WSScheduler::WSScheduler(unsigned long rangeItems, int computeUnits, 
+                         const CpuLayout *cpus){
+    int counter;
+
+    this->rangeItems = rangeItems;
+    this->grain = 1;
+    this->unclaimed = 0;
+    this->pushSeq = 0;
+    this->idle = 0;
+    this->workers = 0;
+    this->running = 0;
+    pthread_mutex_init(&(this->idle_mx), NULL);
+    pthread_cond_init(&(this->idle_cond), NULL);
+    pthread_mutex_init(&(this->done_mx), NULL);
+    pthread_cond_init(&(this->done_cond), NULL);
+    this->deques.resize(computeUnits);
+    this->firstRanges.resize(computeUnits);
+    for(counter = 0; counter < computeUnits; counter++){
+        this->seeds.push_back(counter + 1);
+    }
+    this->createUnits(computeUnits, cpus);
+}
+
+WSScheduler::~WSScheduler(){
+    this->deleteUnits();
+}
+
+/*!****************************************************************************
+ * @brief Split a range in halves along its outermost dimension that can be
+ *        split, unless it is no larger than the grain
+ * @param range Keeps the lower half
+ * @param upper Receives the upper half
+ * @return false if the range was left whole
+ *****************************************************************************/
+bool WSScheduler::split(WorkRange *range, WorkRange *upper){
+    unsigned long items = 1;
+    unsigned int mid;
+    int dim;
+
+    for(dim = 0; dim < 3; dim++){
+        items *= range->end[dim] - range->begin[dim];
+    }
+    if(items <= this->grain){
+        return false;
+    }
+    for(dim = 2; dim > 0 && range->end[dim] - range->begin[dim] < 2; dim--);
+    mid = range->begin[dim] + (range->end[dim] - range->begin[dim]) / 2;
+    *upper = *range;
+    upper->begin[dim] = mid;
+    range->end[dim] = mid;
+    return true;
+}
+
+/*!****************************************************************************
+ * @brief Steal a range from another compute unit of the launch, starting
+ *        from a random one
+ *****************************************************************************/
+bool WSScheduler::stealAny(int self, WorkRange *range){
+    unsigned int seed = this->seeds[self];
+    int counter;
+    int victim;
+
+    /*! xorshift, good enough to spread the thieves */
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    this->seeds[self] = seed;
+    for(counter = 0; counter < this->workers; counter++){
+        victim = (seed + counter) % this->workers;
+        if(victim != self && this->deques[victim].steal(range)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!****************************************************************************
+ * @brief Wake sleeping compute units after a push or when the launch runs
+ *        out. The lock is only taken when someone sleeps.
+ *****************************************************************************/
+void WSScheduler::wakeIdle(){
+    if(__atomic_load_n(&(this->idle), __ATOMIC_SEQ_CST) > 0){
+        pthread_mutex_lock(&(this->idle_mx));
+        pthread_cond_broadcast(&(this->idle_cond));
+        pthread_mutex_unlock(&(this->idle_mx));
+    }
+}
+
+/*!****************************************************************************
+ * @brief Take a range from our own deque, or steal one. Ranges larger than
+ *        the grain are split, the upper halves left for thieves.
+ * @return false once every work item of the launch has been handed out
+ *****************************************************************************/
+bool WSScheduler::nextRange(ComputeUnit *cu, unsigned int begin[3], unsigned int end[3]){
+    int self = cu->designation;
+    WorkRange range, upper, whole;
+    unsigned long seq;
+    unsigned long items = 1;
+    bool pushed = false;
+    int round;
+    int dim;
+
+    if(!this->deques[self].take(&range)){
+        for(round = 0; ; round++){
+            /*! Read before looking, so a push made after the last look
+             *  keeps us awake */
+            seq = __atomic_load_n(&(this->pushSeq), __ATOMIC_SEQ_CST);
+            if(this->stealAny(self, &range)){
+                break;
+            }
+            if(__atomic_load_n(&(this->unclaimed), __ATOMIC_SEQ_CST) == 0){
+                return false;
+            }
+            if(round < WS_STEAL_ROUNDS){
+                sched_yield();
+                continue;
+            }
+            pthread_mutex_lock(&(this->idle_mx));
+            __atomic_add_fetch(&(this->idle), 1, __ATOMIC_SEQ_CST);
+            while(__atomic_load_n(&(this->pushSeq), __ATOMIC_SEQ_CST) == seq &&
+                  __atomic_load_n(&(this->unclaimed), __ATOMIC_SEQ_CST) > 0){
+                pthread_cond_wait(&(this->idle_cond), &(this->idle_mx));
+            }
+            __atomic_sub_fetch(&(this->idle), 1, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&(this->idle_mx));
+        }
+    }
+
+    whole = range;
+    while(this->split(&range, &upper)){
+        if(!this->deques[self].push(&upper)){
+            range = whole;
+            break;
+        }
+        whole = range;
+        pushed = true;
+    }
+    if(pushed){
+        __atomic_add_fetch(&(this->pushSeq), 1, __ATOMIC_SEQ_CST);
+        this->wakeIdle();
+    }
+
+    for(dim = 0; dim < 3; dim++){
+        begin[dim] = range.begin[dim];
+        end[dim] = range.end[dim];
+        items *= range.end[dim] - range.begin[dim];
+    }
+    if(__atomic_sub_fetch(&(this->unclaimed), items, __ATOMIC_SEQ_CST) == 0){
+        this->wakeIdle();
+    }
+    return true;
+}
+
+/*!****************************************************************************
+ * @brief Run a kernel over an NDRange. The launch is split into one range
+ *        per compute unit to start with; from there on they split their
+ *        ranges and steal from each other.
+ * @param launch Kernel, work size and arguments
+ *****************************************************************************/
+void WSScheduler::addWork(const KernelLaunch *launch){
+    WorkRange *work = &(this->firstRanges[0]);
+    int units = this->units.size();
+    unsigned long total = 1;
+    int count, last;
+    int counter;
+
+    this->waitTurn();
+
+    for(counter = 0; counter < 3; counter++){
+        work[0].begin[counter] = 0;
+        work[0].end[counter] = launch->globalSize[counter];
+        total *= launch->globalSize[counter];
+    }
+    this->grain = this->rangeItems;
+    if(this->grain == 0){
+        this->grain = total / (units * WS_RANGES_PER_CU);
+    }
+    if(this->grain == 0){
+        this->grain = 1;
+    }
+    for(count = 1, last = 0; count < units && count != last; ){
+        last = count;
+        for(counter = 0; counter < last && count < units; counter++){
+            if(this->split(&work[counter], &work[count])){
+                count++;
+            }
+        }
+    }
+    DEBUG("%s: %d compute units, grain %lu\n", __func__, count, this->grain);
+
+    this->unclaimed = total;
+    this->workers = count;
+    this->running = count;
+    for(counter = 0; counter < count; counter++){
+        this->deques[counter].push(&work[counter]);
+    }
+    for(counter = 0; counter < count; counter++){
+        this->units[counter]->run_kernel(launch);
+    }
+
+    pthread_mutex_lock(&(this->done_mx));
+    while(this->running > 0){
+        pthread_cond_wait(&(this->done_cond), &(this->done_mx));
+    }
+    pthread_mutex_unlock(&(this->done_mx));
+
+    for(counter = 0; counter < count; counter++){
+        this->units[counter]->join();
+    }
+
+    this->endTurn();
+}
+
+void WSScheduler::CUDone(ComputeUnit *){
+    pthread_mutex_lock(&(this->done_mx));
+    if(--(this->running) == 0){
+        pthread_cond_signal(&(this->done_cond));
+    }
+    pthread_mutex_unlock(&(this->done_mx));
+}
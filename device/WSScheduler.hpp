@@ -0,0 +1,80 @@
+/*!****************************************************************************
+ * @file WSScheduler.hpp Work stealing scheduler Definitions
+ * @author Jacky H T Luk 2013
+ *****************************************************************************/
+#if !defined(WSSCHEDULER_HPP)
+#define WSSCHEDULER_HPP
+
+#include "IScheduler.hpp"
+#include "ComputeUnit.hpp"
+#include "GlobalDef.hpp"
+#include <pthread.h>
+#include <vector>
+
+/* Ranges a compute unit can have waiting. Ranges are split in halves, so a
+ * deque holds at most one range per halving and never fills up. */
+#define WS_DEQUE_SIZE 128
+/* Work items per range when the grain is left to the scheduler: launches
+ * are cut this much finer than one range per compute unit */
+#define WS_RANGES_PER_CU 16
+/* Steal attempts before an idle compute unit sleeps */
+#define WS_STEAL_ROUNDS 64
+
+/*! A box of work items, [begin, end) in each dimension */
+struct WorkRange{
+    unsigned int begin[3];
+    unsigned int end[3];
+};
+
+/*!
+ * Chase-Lev deque of ranges. The owning compute unit pushes and takes at the
+ * bottom, others steal from the top. It does not grow; push fails when full.
+ */
+class RangeDeque{
+    long top;
+    long bottom;
+    WorkRange ranges[WS_DEQUE_SIZE];
+public:
+    RangeDeque();
+    bool push(const WorkRange *range);
+    bool take(WorkRange *range);
+    bool steal(WorkRange *range);
+};
+
+class WSScheduler: public IScheduler{
+    std::vector<RangeDeque> deques;     /*! Per compute unit */
+    std::vector<unsigned int> seeds;    /*! Victim choice, per compute unit */
+    std::vector<WorkRange> firstRanges; /*! One per compute unit taking part */
+    unsigned long rangeItems;           /*! Work items per range, 0 to size adaptively */
+    unsigned long grain;                /*! Ranges are not split below this many items */
+    unsigned long unclaimed;            /*! Items of the launch not handed out yet */
+
+    /*! Idle compute units sleep until a range is pushed or the launch runs out */
+    unsigned long pushSeq;
+    int idle;
+    pthread_mutex_t idle_mx;
+    pthread_cond_t idle_cond;
+
+    /*! Compute units taking part in the launch, and those still running it */
+    int workers;
+    int running;
+    pthread_mutex_t done_mx;
+    pthread_cond_t done_cond;
+
+    bool split(WorkRange *range, WorkRange *upper);
+    bool stealAny(int self, WorkRange *range);
+    void wakeIdle();
+public:
+
+    WSScheduler(unsigned long rangeItems, int computeUnits, const CpuLayout *cpus);
+
+    void addWork(const KernelLaunch *launch);
+
+    bool nextRange(ComputeUnit *cu, unsigned int begin[3], unsigned int end[3]);
+
+    void CUDone(ComputeUnit *free_cu);
+
+    virtual ~WSScheduler();
+};
+
+#endif //WSSCHEDULER_HPP
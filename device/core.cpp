@@ -6,27 +6,94 @@
 #include <sys/types.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
 
 /*! Prototypes */
 void usage(char *name);
+size_t parseSize(const char *arg);
 
 int main(int argc, char *argv[])
 {
+    DeviceOptions options;
+    int opt;
 
-    if(argc < 2){
+    options.memSize = GLOBAL_MEMORY_SIZE;
+    options.hugePages = false;
+    options.numaNode = -1;
+    options.rangeItems = 0;
+    options.workStealing = false;
+    options.computeUnits = 0;
+    options.pin = false;
+    options.isolate = false;
+    options.report = false;
+
+    while((opt = getopt(argc, argv, "m:Hn:r:s:c:piu")) != -1){
+      switch(opt){
+        case 'm':
+          if((options.memSize = parseSize(optarg)) == 0){
+            usage(argv[0]);
+            return -1;
+          }
+          break;
+        case 'H':
+          options.hugePages = true;
+          break;
+        case 'n':
+          options.numaNode = atoi(optarg);
+          break;
+        case 'r':
+          options.rangeItems = strtoul(optarg, NULL, 0);
+          break;
+        case 'c':
+          options.computeUnits = atoi(optarg);
+          if(options.computeUnits <= 0 || options.computeUnits > COMPUTE_UNIT_MAX){
+            usage(argv[0]);
+            return -1;
+          }
+          break;
+        case 'p':
+          options.pin = true;
+          break;
+        case 'i':
+          options.isolate = true;
+          break;
+        case 'u':
+          options.report = true;
+          break;
+        case 's':
+          if(strcmp(optarg, "ws") == 0){
+            options.workStealing = true;
+          }else if(strcmp(optarg, "tp") == 0){
+            options.workStealing = false;
+          }else{
+            usage(argv[0]);
+            return -1;
+          }
+          break;
+        default:
+          usage(argv[0]);
+          return -1;
+      }
+    }
+
+    if(optind >= argc){
       usage(argv[0]);
       return -1;
     }
-      
-    int port = atoi(argv[1]);
-    Device device(port);
-    
-    
+
+    int port = atoi(argv[optind]);
+
+    /* A host that goes away mid reply must not take the other hosts' 
+       sessions with it, failed sends end its session instead */
+    signal(SIGPIPE, SIG_IGN);
 
     /* start processing thread */
     try{
+      Device device(port, &options);
       while(1){
-        
+
         device.start();
 
         //pthread_join(proc_thread, NULL);
@@ -40,6 +107,33 @@ int main(int argc, char *argv[])
     return 0;
 }
 
+/*!****************************************************************************
+ * @brief parseSize Parse a memory size with an optional K, M or G suffix
+ * @return Size in bytes, 0 if the argument is not a size
+ * ***************************************************************************/
+size_t parseSize(const char *arg){
+    char *end;
+    size_t size = strtoull(arg, &end, 0);
+
+    switch(*end){
+      case 'g': case 'G': size <<= 10; /* fall through */
+      case 'm': case 'M': size <<= 10; /* fall through */
+      case 'k': case 'K': size <<= 10; end++; break;
+      case '\0': break;
+      default: return 0;
+    }
+    return (*end == '\0') ? size : 0;
+}
+
 void usage(char *name){
-    printf("%s <port>\n", name);
-}
\ No newline at end of file
+    printf("%s [-m size[K|M|G]] [-H] [-n node] [-r items] [-s tp|ws] [-c count] [-p] [-i] [-u] <port>\n", name);
+    printf("  -m  global memory size, default %luM\n", GLOBAL_MEMORY_SIZE >> 20);
+    printf("  -H  back global memory with huge pages\n");
+    printf("  -n  bind global memory to a NUMA node\n");
+    printf("  -r  work items run per scheduling step, default sized per launch\n");
+    printf("  -s  scheduler: tp thread pool (default), ws work stealing\n");
+    printf("  -c  compute units, default one per CPU, at most %d\n", COMPUTE_UNIT_MAX);
+    printf("  -p  pin compute units to CPUs, those of the -n node only\n");
+    printf("  -i  keep a CPU for the network threads\n");
+    printf("  -u  report compute unit utilisation as each host disconnects\n");
+}
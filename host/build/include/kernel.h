@@ -0,0 +1,64 @@
+/* definitions needed to compile OpenCL kernels using a C compiler */
+
+#include <stdlib.h>
+
+/* Work-item context, set by the kernel wrapper before it runs each work 
+ * item. Compute units run work items side by side, so it is per thread. It
+ * lives in the device executable, which makes the initial-exec model safe 
+ * for kernels loaded at run time: reads are a single load. Work groups are 
+ * a single work item. */
+typedef struct {
+	size_t global_id[3];
+	size_t global_size[3];
+	size_t global_offset[3];
+} novelcl_context_t;
+
+extern __thread novelcl_context_t novelcl_context __attribute__((tls_model("initial-exec")));
+
+#define __global
+#define global
+#define __local
+#define __private
+#define __kernel
+#define kernel
+#define __constant const
+#define __attribute__(x) 
+#define gentype float
+#include <math.h>
+#include <stdint.h>
+#include <inttypes.h>
+typedef unsigned int uint;
+
+#define max(x,y) ((x >= y)?x:y)
+
+static inline size_t get_global_id(unsigned int dimindex){
+	return (dimindex < 3) ? novelcl_context.global_id[dimindex] : 0;
+}
+static inline size_t get_global_size(unsigned int dimindex){
+	return (dimindex < 3) ? novelcl_context.global_size[dimindex] : 1;
+}
+static inline size_t get_global_offset(unsigned int dimindex){
+	return (dimindex < 3) ? novelcl_context.global_offset[dimindex] : 0;
+}
+
+static inline size_t get_local_id(unsigned int dimindex){
+	return 0;
+}
+static inline size_t get_local_size(unsigned int dimindex){
+	return 1;
+}
+
+static inline size_t get_group_id(unsigned int dimindex){
+	return get_global_id(dimindex) - get_global_offset(dimindex);
+}
+static inline size_t get_num_groups(unsigned int dimindex){
+	return get_global_size(dimindex);
+}
+
+uint rotate(uint i, uint j){
+	return (i << j) | i >> (32 - j);
+}
+
+uint bitselect(uint a, uint b, uint c){
+	return (a & ~c) | (b & c);
+}
@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# build an OpenCL kernel using gcc
+# runs in the program's private build directory, which holds tmp.options
+
+src=$1
+target=$1.o
+
+if [ -z $1 ]
+then
+    echo "no argument specified"
+    exit 1
+
+elif [ $1=~.*".cl" -a -e $1 ] #if file exists and matches .cl
+then
+    source tmp.options
+    ( echo -e "#include \"kernel.h\""; cat ${src} ) > ${src}.tmp #append header to source
+    # kernel signatures are read from, and kernel images compiled from, the preprocessed source
+    gcc -E -P -I$NOVELCLSDKROOT/include ${CLFLAGS} -x c -std=c99 -o program.i ${src}.tmp || exit 1
+    gcc -fPIC -Wno-implicit-function-declaration ${CLFLAGS} -g -O2 -x c -std=c99 -c -o ${target} program.i || exit 1
+    mv ${target} program.o
+    exit 0
+else
+    echo "incorrect argument"
+    exit 1
+fi
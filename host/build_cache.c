@@ -0,0 +1,445 @@
+/*!****************************************************************************
+ * @file build_cache.c Build directories and the persistent cache of program 
+ * and kernel builds
+ *
+ * Each program is built in a private scratch directory, so that programs 
+ * and processes can build at the same time without sharing file names.
+ *
+ * Every build is keyed by everything that goes into it. An entry is a
+ * directory named after a hash of the key, holding the full key and the
+ * built files; lookups compare the stored key byte for byte, so a hash
+ * collision is only ever a miss. Entries are written to a temporary
+ * directory and renamed into place, which keeps concurrent processes from
+ * seeing half written entries. The least recently used entries are evicted
+ * once the cache grows past its size limit.
+ *****************************************************************************/
+#include "debug.h"
+#include <CL/opencl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "cl_defs.h"
+
+#define CACHE_KEY_FILE "key"
+/* Room for the cache directory and one entry name below it */
+#define CACHE_ENTRY_MAX (PATH_MAX / 2 + NAME_MAX + 2)
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int cache_initialised = 0;
+static char cache_dir[PATH_MAX / 2];        /*! Empty when the cache is disabled */
+static off_t cache_limit;
+static char cache_toolchain[256];
+static cl_build_cache_statistics_novel cache_stats;
+
+/*!
+* @brief Create a directory and its missing parents
+* @return 0 on success, -1 on error
+*/
+static int cache_mkdirs(const char *path){
+    char buf[PATH_MAX];
+    char *pos;
+
+    if(snprintf(buf, sizeof(buf), "%s", path) >= (int)sizeof(buf))
+        return -1;
+    for(pos = buf + 1; *pos; pos++){
+        if(*pos == '/'){
+            *pos = '\0';
+            if(mkdir(buf, 0700) != 0 && errno != EEXIST)
+                return -1;
+            *pos = '/';
+        }
+    }
+    if(mkdir(buf, 0700) != 0 && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+/*!
+* @brief Pick the cache directory and limit from the environment and record
+*        the compiler version. Called with cache_mutex held.
+*/
+static void cache_init(void){
+    const char *env;
+    const char *home;
+    FILE *version;
+    size_t len;
+
+    if(cache_initialised)
+        return;
+    cache_initialised = 1;
+
+    cache_limit = (off_t)BUILD_CACHE_MAX_MB << 20;
+    if((env = getenv(BUILD_CACHE_MAX_MB_ENV)) != NULL){
+        cache_limit = (off_t)atol(env) << 20;
+    }
+    cache_dir[0] = '\0';
+    if(cache_limit <= 0){
+        DEBUG("%s: build cache disabled\n", __func__);
+        return;
+    }
+
+    if((env = getenv(BUILD_CACHE_DIR_ENV)) != NULL && env[0]){
+        snprintf(cache_dir, sizeof(cache_dir), "%s", env);
+    }else if((env = getenv("XDG_CACHE_HOME")) != NULL && env[0]){
+        snprintf(cache_dir, sizeof(cache_dir), "%s/novelcl", env);
+    }else if((home = getenv("HOME")) != NULL && home[0]){
+        snprintf(cache_dir, sizeof(cache_dir), "%s/.cache/novelcl", home);
+    }
+    if(cache_dir[0] == '\0' || cache_mkdirs(cache_dir) != 0){
+        DEBUG("%s: no usable cache directory\n", __func__);
+        cache_dir[0] = '\0';
+        return;
+    }
+
+    /*! A compiler upgrade invalidates everything built with the old one */
+    cache_toolchain[0] = '\0';
+    if((version = popen("gcc -dumpfullversion -dumpversion 2>/dev/null", "r")) != NULL){
+        if(fgets(cache_toolchain, sizeof(cache_toolchain), version) == NULL)
+            cache_toolchain[0] = '\0';
+        pclose(version);
+    }
+    len = strlen(cache_toolchain);
+    if((env = getenv("NOVELCLSDKROOT")) != NULL){
+        snprintf(cache_toolchain + len, sizeof(cache_toolchain) - len, "%s", env);
+    }
+    DEBUG("%s: build cache in %s, limit %ld MB\n", __func__, cache_dir, (long)(cache_limit >> 20));
+}
+
+/*!
+* @brief Append a length prefixed field, so that fields cannot run into each other
+*/
+static int cache_key_append(CacheKey *key, const void *data, size_t len){
+    size_t need = key->len + sizeof(uint64_t) + len;
+    uint64_t prefix = len;
+    char *grown;
+
+    if(key->data == NULL)
+        return -1;
+    if(need > key->cap){
+        while(need > key->cap)
+            key->cap *= 2;
+        if((grown = realloc(key->data, key->cap)) == NULL){
+            free(key->data);
+            key->data = NULL;
+            return -1;
+        }
+        key->data = grown;
+    }
+    memcpy(key->data + key->len, &prefix, sizeof(prefix));
+    memcpy(key->data + key->len + sizeof(prefix), data, len);
+    key->len = need;
+    return 0;
+}
+
+int cache_key_init(CacheKey *key, const char *kind){
+    key->cap = 4096;
+    key->len = 0;
+    if((key->data = malloc(key->cap)) == NULL)
+        return -1;
+    pthread_mutex_lock(&cache_mutex);
+    cache_init();
+    pthread_mutex_unlock(&cache_mutex);
+    if(cache_key_add(key, kind) != 0)
+        return -1;
+    return cache_key_add(key, cache_toolchain);
+}
+
+int cache_key_add(CacheKey *key, const char *str){
+    return cache_key_append(key, str ? str : "", str ? strlen(str) : 0);
+}
+
+int cache_key_add_file(CacheKey *key, const char *path){
+    FILE *file;
+    long size;
+    char *contents;
+    int ret = -1;
+
+    if(key->data == NULL)
+        return -1;
+    if((file = fopen(path, "rb")) != NULL){
+        if(fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 &&
+           fseek(file, 0, SEEK_SET) == 0 && (contents = malloc(size + 1)) != NULL){
+            if(fread(contents, 1, size, file) == (size_t)size){
+                ret = cache_key_append(key, contents, size);
+            }
+            free(contents);
+        }
+        fclose(file);
+    }
+    /*! A key missing an input would match builds of other inputs */
+    if(ret != 0){
+        cache_key_free(key);
+    }
+    return ret;
+}
+
+void cache_key_free(CacheKey *key){
+    free(key->data);
+    key->data = NULL;
+}
+
+/*!
+* @brief Path of the entry a key belongs in, named after its FNV-1a hash
+*/
+static void cache_entry_path(const CacheKey *key, char *path, size_t len){
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for(i = 0; i < key->len; i++){
+        hash ^= (unsigned char)key->data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    snprintf(path, len, "%s/%016llx", cache_dir, (unsigned long long)hash);
+}
+
+/*!
+* @brief Copy a file, replacing the destination
+* @return 0 on success, -1 on error
+*/
+static int cache_copy(const char *from, const char *to){
+    char buf[64*1024];
+    ssize_t rcount, wcount, done;
+    int in, out;
+    int ret = 0;
+
+    if((in = open(from, O_RDONLY)) < 0)
+        return -1;
+    if((out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0){
+        close(in);
+        return -1;
+    }
+    while(ret == 0 && (rcount = read(in, buf, sizeof(buf))) != 0){
+        if(rcount < 0){
+            if(errno != EINTR) ret = -1;
+            continue;
+        }
+        for(done = 0; done < rcount; done += wcount){
+            if((wcount = write(out, buf + done, rcount - done)) < 0){
+                ret = -1;
+                break;
+            }
+        }
+    }
+    close(in);
+    if(close(out) != 0)
+        ret = -1;
+    return ret;
+}
+
+/*!
+* @brief Create a private build directory under $TMPDIR, or /tmp
+* @return Path of the directory, to be freed by the caller, or NULL on error
+*/
+char *build_dir_create(void){
+    const char *tmpdir = getenv("TMPDIR");
+    char path[PATH_MAX];
+
+    if(tmpdir == NULL || tmpdir[0] == '\0')
+        tmpdir = "/tmp";
+    if(snprintf(path, sizeof(path), "%s/%s", tmpdir, BUILD_DIR_TEMPLATE) >= (int)sizeof(path) ||
+       mkdtemp(path) == NULL){
+        DEBUG("%s: cannot create a build directory in %s\n", __func__, tmpdir);
+        return NULL;
+    }
+    return strdup(path);
+}
+
+/*!
+* @brief Delete a build directory or cache entry and the files in it
+* @return Bytes freed
+*/
+off_t build_dir_remove(const char *path){
+    char file[PATH_MAX];
+    struct dirent *ent;
+    struct stat st;
+    off_t freed = 0;
+    DIR *dir;
+
+    if((dir = opendir(path)) == NULL)
+        return 0;
+    while((ent = readdir(dir)) != NULL){
+        if(ent->d_name[0] == '.')
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+        if(stat(file, &st) == 0)
+            freed += st.st_size;
+        unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+    return freed;
+}
+
+int cache_lookup(const CacheKey *key, const char *dir, const char **files){
+    char entry[CACHE_ENTRY_MAX];
+    char path[PATH_MAX];
+    char target[PATH_MAX];
+    struct stat st;
+    char *stored = NULL;
+    FILE *keyFile;
+    int hit = 0;
+    int i;
+
+    if(key->data == NULL || cache_dir[0] == '\0')
+        return 0;
+    cache_entry_path(key, entry, sizeof(entry));
+    snprintf(path, sizeof(path), "%s/%s", entry, CACHE_KEY_FILE);
+    if(stat(path, &st) == 0 && (size_t)st.st_size == key->len &&
+       (stored = malloc(key->len)) != NULL && (keyFile = fopen(path, "rb")) != NULL){
+        hit = fread(stored, 1, key->len, keyFile) == key->len &&
+              memcmp(stored, key->data, key->len) == 0;
+        fclose(keyFile);
+    }
+    free(stored);
+    for(i = 0; hit && files[i]; i++){
+        snprintf(path, sizeof(path), "%s/%s", entry, files[i]);
+        snprintf(target, sizeof(target), "%s/%s", dir, files[i]);
+        hit = cache_copy(path, target) == 0;
+    }
+    if(hit){
+        /*! The entry's mtime is its last use, which is what eviction goes by */
+        utime(entry, NULL);
+        __atomic_add_fetch(&cache_stats.hits, 1, __ATOMIC_RELAXED);
+        DEBUG("%s: hit %s for %s\n", __func__, entry, files[0]);
+    }else{
+        __atomic_add_fetch(&cache_stats.misses, 1, __ATOMIC_RELAXED);
+        DEBUG("%s: miss %s for %s\n", __func__, entry, files[0]);
+    }
+    return hit;
+}
+
+/*!
+* @brief Oldest first, for eviction
+*/
+typedef struct CacheEntry_t{
+    char name[NAME_MAX + 1];
+    time_t used;
+    off_t size;
+} CacheEntry;
+
+static int cache_entry_older(const void *a, const void *b){
+    const CacheEntry *ea = a;
+    const CacheEntry *eb = b;
+    return (ea->used > eb->used) - (ea->used < eb->used);
+}
+
+/*!
+* @brief Evict least recently used entries until the cache fits its limit.
+*        Called with cache_mutex held.
+*/
+static void cache_evict(void){
+    char path[CACHE_ENTRY_MAX];
+    char file[PATH_MAX];
+    CacheEntry *entries = NULL;
+    CacheEntry *grown;
+    size_t count = 0, cap = 0, i;
+    struct dirent *ent, *fent;
+    struct stat st;
+    off_t total = 0;
+    DIR *dir, *edir;
+
+    if((dir = opendir(cache_dir)) == NULL)
+        return;
+    while((ent = readdir(dir)) != NULL){
+        /*! Temporary directories of builds in flight start with a dot */
+        if(ent->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, ent->d_name);
+        if(stat(path, &st) != 0 || !S_ISDIR(st.st_mode) || (edir = opendir(path)) == NULL)
+            continue;
+        if(count == cap){
+            cap = cap ? cap * 2 : 64;
+            if((grown = realloc(entries, cap * sizeof(CacheEntry))) == NULL){
+                closedir(edir);
+                break;
+            }
+            entries = grown;
+        }
+        snprintf(entries[count].name, sizeof(entries[count].name), "%s", ent->d_name);
+        entries[count].used = st.st_mtime;
+        entries[count].size = 0;
+        while((fent = readdir(edir)) != NULL){
+            snprintf(file, sizeof(file), "%s/%s", path, fent->d_name);
+            if(fent->d_name[0] != '.' && stat(file, &st) == 0)
+                entries[count].size += st.st_size;
+        }
+        closedir(edir);
+        total += entries[count].size;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(entries, count, sizeof(CacheEntry), cache_entry_older);
+    for(i = 0; i < count && total > cache_limit; i++){
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entries[i].name);
+        total -= build_dir_remove(path);
+        cache_stats.evictions++;
+        DEBUG("%s: evicted %s\n", __func__, path);
+    }
+    cache_stats.bytes = total;
+    free(entries);
+}
+
+void cache_store(const CacheKey *key, const char *dir, const char **files){
+    char entry[CACHE_ENTRY_MAX];
+    char tmp[CACHE_ENTRY_MAX];
+    char path[PATH_MAX];
+    char source[PATH_MAX];
+    FILE *keyFile;
+    int ok;
+    int i;
+
+    if(key->data == NULL || cache_dir[0] == '\0')
+        return;
+    snprintf(tmp, sizeof(tmp), "%s/.tmp.XXXXXX", cache_dir);
+    if(mkdtemp(tmp) == NULL)
+        return;
+
+    snprintf(path, sizeof(path), "%s/%s", tmp, CACHE_KEY_FILE);
+    ok = (keyFile = fopen(path, "wb")) != NULL;
+    if(ok){
+        ok = fwrite(key->data, 1, key->len, keyFile) == key->len;
+        ok = (fclose(keyFile) == 0) && ok;
+    }
+    for(i = 0; ok && files[i]; i++){
+        snprintf(path, sizeof(path), "%s/%s", tmp, files[i]);
+        snprintf(source, sizeof(source), "%s/%s", dir, files[i]);
+        ok = cache_copy(source, path) == 0;
+    }
+
+    cache_entry_path(key, entry, sizeof(entry));
+    pthread_mutex_lock(&cache_mutex);
+    if(ok && rename(tmp, entry) != 0){
+        /*! Another build of the same key got there first, or a colliding
+         *  entry is in the way; the newer build replaces it */
+        build_dir_remove(entry);
+        ok = rename(tmp, entry) == 0;
+    }
+    if(ok){
+        cache_stats.stores++;
+        cache_evict();
+    }else{
+        build_dir_remove(tmp);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void cache_statistics(cl_build_cache_statistics_novel *stats){
+    pthread_mutex_lock(&cache_mutex);
+    cache_init();
+    stats->hits = __atomic_load_n(&cache_stats.hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&cache_stats.misses, __ATOMIC_RELAXED);
+    stats->stores = cache_stats.stores;
+    stats->evictions = cache_stats.evictions;
+    stats->bytes = cache_stats.bytes;
+    pthread_mutex_unlock(&cache_mutex);
+}
@@ -8,8 +8,41 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 #include "cl_defs.h"
 
+/*!
+* @brief Pick a key for a new context's address space on the device. Hosts 
+*        on other machines share the device, so keys are random rather than 
+*        derived from the process; the clock, process and a counter stand in
+*        when no random bytes can be had.
+* @return Key, never 0
+*/
+static uint64_t context_space_key(void){
+    static pthread_mutex_t key_mutex = PTHREAD_MUTEX_INITIALIZER;
+    static uint64_t counter = 0;
+    struct timespec ts;
+    uint64_t key = 0;
+    FILE *urandom;
+    
+    if((urandom = fopen("/dev/urandom", "rb")) != NULL){
+        if(fread(&key, sizeof(key), 1, urandom) != 1){
+            key = 0;
+        }
+        fclose(urandom);
+    }
+    pthread_mutex_lock(&key_mutex);
+    counter++;
+    if(key == 0){
+        clock_gettime(CLOCK_REALTIME, &ts);
+        key = ((uint64_t)getpid() << 40) ^ ((uint64_t)ts.tv_sec << 20) ^ ts.tv_nsec ^ (counter << 52);
+    }
+    pthread_mutex_unlock(&key_mutex);
+    return key ? key : 1;
+}
+
 /*!
 * @brief Creates an OpenCL context.
 * @param properties Specifies a list of context property names and their corresponding values. Each property name is immediately followed by the corresponding desired value. The list is terminated with 0. properties can be NULL in which case the platform that is selected is implementation-defined. 
@@ -75,9 +108,32 @@ cl_int *errcode_ret)
     /*! copy the list of device pointers to context memory */
     memcpy(context->devices, devices, num_devices * sizeof(cl_device_id));
     
+    /*! The device keeps the context's memory while this connection is 
+     *  open, so buffers outlive the queues that use them */
+    context->spaceKey = context_space_key();
+    if( (context->fd_space = dev_connect(CONN_CTRL)) == -1){
+        free(context->devices);
+        free(context);
+        if(errcode_ret) *errcode_ret = CL_DEVICE_NOT_AVAILABLE;
+        return NULL;
+    }
+    if(dev_hello(context->fd_space, context->spaceKey, NULL) != 0){
+        dev_disconnect(context->fd_space);
+        free(context->devices);
+        free(context);
+        if(errcode_ret) *errcode_ret = CL_DEVICE_NOT_AVAILABLE;
+        return NULL;
+    }
+    if(mem_context_init(context) != CL_SUCCESS){
+        dev_disconnect(context->fd_space);
+        free(context->devices);
+        free(context);
+        if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
+        return NULL;
+    }
+    
     context->num_devices = num_devices;
     if(properties) memcpy(context->props, properties, sizeof(context->props));
-    context->mem_alloc_offset = 0;
     if(errcode_ret) *errcode_ret = CL_SUCCESS;
     
     return context;
@@ -122,7 +178,7 @@ cl_context context)
     if(context == NULL)
         return CL_INVALID_CONTEXT;
 
-    context->refcount += 1;
+    __atomic_add_fetch(&(context->refcount), 1, __ATOMIC_ACQ_REL);
 
     return CL_SUCCESS;
 }
@@ -136,11 +192,11 @@ cl_context context)
     if(context == NULL)
         return CL_INVALID_CONTEXT;
 
-    if(context->refcount > 0)
-        context->refcount -= 1;
-    if(context->refcount == 0){
+    if(__atomic_sub_fetch(&(context->refcount), 1, __ATOMIC_ACQ_REL) == 0){
         cl_uint counter;
         
+        mem_context_release(context);
+        dev_disconnect(context->fd_space);
         for(counter = 0; counter < context->num_devices; counter++){
             free(context->devices[counter]);
         }
@@ -162,6 +218,7 @@ size_t *param_value_size_ret)
 {
     void *param;
     size_t param_size;
+    cl_memory_statistics_novel stats;
 
     DEBUG("clGetContextInfo called\n");
     if(context == NULL)
@@ -188,6 +245,12 @@ size_t *param_value_size_ret)
             param_size = sizeof(context->props);
             break;
 
+        case CL_CONTEXT_MEMORY_STATISTICS_NOVEL:
+            mem_statistics(context, &stats);
+            param = &stats;
+            param_size = sizeof(stats);
+            break;
+
         default:
             return CL_INVALID_VALUE;
     }
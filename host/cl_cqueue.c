@@ -13,10 +13,19 @@
 #include <pthread.h>
 #include <time.h>
 #include <arpa/inet.h>
+#include <endian.h>
 #include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/socket.h>
 
 void *queue_worker(void *arg);
 
+typedef int (*queue_pred_t)(cl_command_queue command_queue, void *arg);
+
+/*! Access range of commands whose buffers are not known */
+static const MemAccess queue_all_memory = {0, (size_t)-1, CL_TRUE};
+
 
 cl_command_queue clCreateCommandQueue(
 cl_context context,
@@ -25,39 +34,79 @@ cl_command_queue_properties properties,
 cl_int *errcode_ret)
 {
     cl_command_queue cqueue;
-    int fd_ctrl;
+    char *spin;
+    char *maxCommands;
+    cl_uint i;
 
     DEBUG("clCreateCommandQueue called\n");
+    if(context == NULL){
+        if(errcode_ret) *errcode_ret = CL_INVALID_CONTEXT;
+        return NULL;
+    }
     if( (cqueue = (cl_command_queue)malloc(sizeof(struct _cl_command_queue))) == NULL){
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
         return NULL;
     }
+    /*! Independent commands only overlap with more than one dispatch thread */
+    cqueue->numWorkers = (properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) ? QUEUE_OOO_WORKERS : 1;
+    if( (cqueue->workers = (pthread_t *)malloc(cqueue->numWorkers * sizeof(pthread_t))) == NULL){
+        free(cqueue);
+        if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
+        return NULL;
+    }
     
-    if(device->connected == CL_FALSE){
-        fd_ctrl = dev_connect(CONN_CTRL);
-        if( (fd_ctrl  == -1) ){
-            if(errcode_ret) *errcode_ret = CL_INVALID_DEVICE;
-            return NULL;
-        }
-        device->connected = CL_TRUE;
-        device->fd_ctrl = fd_ctrl;
+    /*! Each queue has a session of its own on the device */
+    if( (cqueue->fd_ctrl = dev_connect(CONN_CTRL)) == -1){
+        free(cqueue->workers);
+        free(cqueue);
+        if(errcode_ret) *errcode_ret = CL_INVALID_DEVICE;
+        return NULL;
     }
-    else{ /* only one control and data connection to device allowed */
-        if(errcode_ret) *errcode_ret = CL_OUT_OF_RESOURCES;
+    if(dev_hello(cqueue->fd_ctrl, context->spaceKey, NULL) != 0){
+        dev_disconnect(cqueue->fd_ctrl);
+        free(cqueue->workers);
+        free(cqueue);
+        if(errcode_ret) *errcode_ret = CL_INVALID_DEVICE;
         return NULL;
     }
+    cqueue->kernelCount = 0;
+    memset(cqueue->inflight, 0, sizeof(cqueue->inflight));
+    cqueue->nextId = 0;
+    cqueue->connLost = 0;
     
     cqueue->refcount = 1; /* implicit retain */
     cqueue->context = context;
     cqueue->device = device;
     cqueue->props = properties;
     cqueue->queue = NULL;
-    cqueue->currentEvent = NULL;
+    cqueue->queueTail = NULL;
+    cqueue->freeCommands = NULL;
+    cqueue->slabs = NULL;
+    cqueue->numReady = 0;
+    cqueue->outstanding = 0;
+    maxCommands = getenv(QUEUE_MAX_COMMANDS_ENV);
+    cqueue->maxOutstanding = maxCommands ? strtoul(maxCommands, NULL, 10) : QUEUE_MAX_COMMANDS;
+    /*! Spinning only pays off when the queue thread has a core of its own */
+    spin = getenv(QUEUE_SPIN_ENV);
+    cqueue->spin_ns = 0;
+    if(spin && sysconf(_SC_NPROCESSORS_ONLN) > 1){
+        cqueue->spin_ns = strtoul(spin, NULL, 10) * 1000;
+    }
+    cqueue->worker_wait_ns = cqueue->spin_ns;
+    cqueue->host_wait_ns = cqueue->spin_ns;
     if(errcode_ret) *errcode_ret = CL_SUCCESS;
     
     pthread_mutex_init(&(cqueue->queue_mutex), NULL);
-    /*! Start queue thread*/
-    pthread_create(&(cqueue->queue_thread), NULL, queue_worker, cqueue);
+    pthread_mutex_init(&(cqueue->conn_mutex), NULL);
+    pthread_mutex_init(&(cqueue->reply_mutex), NULL);
+    pthread_cond_init(&(cqueue->queue_cond), NULL);
+    pthread_cond_init(&(cqueue->done_cond), NULL);
+    pthread_cond_init(&(cqueue->reply_cond), NULL);
+    pthread_create(&(cqueue->receiver), NULL, queue_receiver, cqueue);
+    /*! Start queue threads*/
+    for(i = 0; i < cqueue->numWorkers; i++){
+        pthread_create(&(cqueue->workers[i]), NULL, queue_worker, cqueue);
+    }
     
     return cqueue;
 }
@@ -81,20 +130,49 @@ cl_command_queue command_queue)
 cl_int clReleaseCommandQueue(
 cl_command_queue command_queue)
 {
+    CommandSlab *slab;
+    cl_uint i;
+
     DEBUG("clReleaseCommandQueue called\n");
     if(command_queue == NULL)
         return CL_INVALID_COMMAND_QUEUE;
 
+    pthread_mutex_lock(&(command_queue->queue_mutex));
     if(command_queue->refcount > 0)
         command_queue->refcount -= 1;
     if(command_queue->refcount == 0){
+        /*! Wake the queue threads so they can drain and stop */
+        pthread_cond_broadcast(&(command_queue->queue_cond));
+        pthread_mutex_unlock(&(command_queue->queue_mutex));
                 
-        /*! Wait for the queue thread to stop*/
-        pthread_join(command_queue->queue_thread, NULL);
+        /*! Wait for the queue threads to stop*/
+        for(i = 0; i < command_queue->numWorkers; i++){
+            pthread_join(command_queue->workers[i], NULL);
+        }
+        free(command_queue->workers);
+        /*! Nothing is waiting for the device any more, the receiver stops 
+         *  at the end of the stream */
+        shutdown(command_queue->fd_ctrl, SHUT_RDWR);
+        pthread_join(command_queue->receiver, NULL);
         
-        dev_disconnect(command_queue->device->fd_ctrl);
-        command_queue->device->connected = CL_FALSE;
+        while(command_queue->queue){
+            queue_remove(command_queue, command_queue->queue);
+        }
+        while(command_queue->slabs){
+            slab = command_queue->slabs;
+            command_queue->slabs = slab->next;
+            free(slab);
+        }
+        dev_disconnect(command_queue->fd_ctrl);
+        pthread_cond_destroy(&(command_queue->reply_cond));
+        pthread_cond_destroy(&(command_queue->done_cond));
+        pthread_cond_destroy(&(command_queue->queue_cond));
+        pthread_mutex_destroy(&(command_queue->reply_mutex));
+        pthread_mutex_destroy(&(command_queue->conn_mutex));
+        pthread_mutex_destroy(&(command_queue->queue_mutex));
         free(command_queue);
+    }else{
+        pthread_mutex_unlock(&(command_queue->queue_mutex));
     }
 
     return CL_SUCCESS;
@@ -157,138 +235,778 @@ cl_int clFlush(cl_command_queue command_queue){
     return CL_SUCCESS;
 }
 
+/*! 
+* @brief Wait until a condition on the queue holds. Must be called with the 
+*        queue mutex held, which is also held on return.
+*        When the queue has a spin budget the caller first polls the predicate
+*        without the lock for up to twice the recent average wait (bounded by
+*        the budget) before sleeping on the condition variable.
+* @param command_queue Command queue object
+* @param cond Condition variable signalled when the predicate may have changed
+* @param ready Predicate to wait for
+* @param arg Argument passed to the predicate
+* @param estimate Running average of wait durations for this call site
+*/
+static void queue_wait(cl_command_queue command_queue, pthread_cond_t *cond, 
+                       queue_pred_t ready, void *arg, unsigned long *estimate){
+    unsigned long start, limit;
+    
+    if(ready(command_queue, arg)) return;
+    
+    if(command_queue->spin_ns == 0){
+        while(!ready(command_queue, arg)){
+            pthread_cond_wait(cond, &(command_queue->queue_mutex));
+        }
+        return;
+    }
+    
+    start = event_clock();
+    limit = *estimate * 2;
+    if(limit > command_queue->spin_ns) limit = command_queue->spin_ns;
+    pthread_mutex_unlock(&(command_queue->queue_mutex));
+    while(!ready(command_queue, arg) && (event_clock() - start) < limit){
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#endif
+    }
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    while(!ready(command_queue, arg)){
+        pthread_cond_wait(cond, &(command_queue->queue_mutex));
+    }
+    *estimate = (*estimate * 7 + (event_clock() - start)) / 8;
+}
+
+/*! Predicates may be polled without the queue mutex while spinning */
+static int queue_is_idle(cl_command_queue command_queue, void *arg){
+    return __atomic_load_n(&(command_queue->outstanding), __ATOMIC_ACQUIRE) == 0;
+}
+
+/*! A released queue is finished once everything on it has completed */
+static int queue_has_work(cl_command_queue command_queue, void *arg){
+    return __atomic_load_n(&(command_queue->numReady), __ATOMIC_ACQUIRE) != 0 || 
+           (__atomic_load_n(&(command_queue->refcount), __ATOMIC_ACQUIRE) == 0 && 
+            __atomic_load_n(&(command_queue->outstanding), __ATOMIC_ACQUIRE) == 0);
+}
+
+static int queue_event_complete(cl_command_queue command_queue, void *arg){
+    return __atomic_load_n(&(((cl_event)arg)->status), __ATOMIC_ACQUIRE) <= CL_COMPLETE;
+}
+
+static int queue_has_room(cl_command_queue command_queue, void *arg){
+    return command_queue->maxOutstanding == 0 || 
+           __atomic_load_n(&(command_queue->outstanding), __ATOMIC_ACQUIRE) < command_queue->maxOutstanding;
+}
+
+/*! 
+* @brief Block until a command on the queue has completed. The command may 
+*        be recycled once it completes, so the caller holds a reference to 
+*        its event instead.
+* @param command_queue Command queue object
+* @param event Event of the command
+* @return CL_SUCCESS, or the error the command completed with
+*/
+cl_int queue_wait_event(cl_command_queue command_queue, cl_event event){
+    cl_int status;
+    
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    queue_wait(command_queue, &(command_queue->done_cond), queue_event_complete, 
+               event, &(command_queue->host_wait_ns));
+    pthread_mutex_unlock(&(command_queue->queue_mutex));
+    
+    pthread_mutex_lock(&(event->event_mutex));
+    status = event->status;
+    pthread_mutex_unlock(&(event->event_mutex));
+    
+    return status;
+}
+
 cl_int clFinish(cl_command_queue command_queue){
-    int done;
     /*! Sanity check */
     if(command_queue == NULL)
         return CL_INVALID_COMMAND_QUEUE;
     
-    
-    while(1){
-        pthread_mutex_lock(&(command_queue->queue_mutex));
-        done = (command_queue->currentEvent == NULL);
-        pthread_mutex_unlock(&(command_queue->queue_mutex));
-        if(done){
-            return CL_SUCCESS;
-        }else{
-            usleep(1000);
-        }
-    }
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    queue_wait(command_queue, &(command_queue->done_cond), queue_is_idle, 
+               NULL, &(command_queue->host_wait_ns));
+    pthread_mutex_unlock(&(command_queue->queue_mutex));
 
     return CL_SUCCESS;
 }
 
 cl_int clEnqueueBarrier(cl_command_queue command_queue){
     QueueCommand *newCmd;
+    if(command_queue == NULL)
+        return CL_INVALID_COMMAND_QUEUE;
+    
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    DEBUG("%s called\n", __func__);
+    newCmd = queue_add(command_queue, CL_CUSTOM_COMMAND_BARRIER, NULL, 0, 0, NULL);
+    pthread_mutex_unlock(&(command_queue->queue_mutex));
+    if(NULL == newCmd){
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clEnqueueMarker(cl_command_queue command_queue, cl_event *event){
+    QueueCommand *newCmd;
+    if(command_queue == NULL)
+        return CL_INVALID_COMMAND_QUEUE;
+    if(event == NULL)
+        return CL_INVALID_VALUE;
+    
     pthread_mutex_lock(&(command_queue->queue_mutex));
     DEBUG("%s called\n", __func__);
-    newCmd = queue_add(command_queue);
+    newCmd = queue_add(command_queue, CL_COMMAND_MARKER, NULL, 0, 0, NULL);
     if(NULL == newCmd){
         pthread_mutex_unlock(&(command_queue->queue_mutex));
         return CL_OUT_OF_HOST_MEMORY;
     }
+    clRetainEvent(newCmd->event);
+    *event = newCmd->event;
+    pthread_mutex_unlock(&(command_queue->queue_mutex));
+    return CL_SUCCESS;
+}
+
+cl_int clEnqueueWaitForEvents(cl_command_queue command_queue, 
+                              cl_uint num_events, 
+                              const cl_event *event_list){
+    QueueCommand *newCmd;
+    if(command_queue == NULL)
+        return CL_INVALID_COMMAND_QUEUE;
+    if(num_events == 0 || event_check_wait_list(num_events, event_list) != CL_SUCCESS)
+        return CL_INVALID_VALUE;
     
-    newCmd->eventStatus = CL_QUEUED;
-    newCmd->commandType = CL_CUSTOM_COMMAND_BARRIER;
-    newCmd->payload = NULL;
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    DEBUG("%s called\n", __func__);
+    newCmd = queue_add(command_queue, CL_CUSTOM_COMMAND_BARRIER, NULL, 0, num_events, event_list);
     pthread_mutex_unlock(&(command_queue->queue_mutex));
+    if(NULL == newCmd){
+        return CL_OUT_OF_HOST_MEMORY;
+    }
     return CL_SUCCESS;
 }
 
+/*! 
+* @brief Check whether a command has to wait for an earlier, unfinished one. 
+*        In-order queues chain each command to the one before it; 
+*        out-of-order queues only order commands that touch overlapping 
+*        device memory where either writes, and around barriers and markers.
+* @param command_queue Command queue object
+* @param earlier Command enqueued first
+* @param later Command enqueued after it
+* @return Non-zero if later depends on earlier
+*/
+static int queue_conflicts(cl_command_queue command_queue, QueueCommand *earlier, QueueCommand *later){
+    cl_uint i, j;
+    
+    if(!(command_queue->props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE))
+        return earlier->next == later;
+    
+    if(later->commandType == CL_CUSTOM_COMMAND_BARRIER || 
+       later->commandType == CL_COMMAND_MARKER || 
+       earlier->commandType == CL_CUSTOM_COMMAND_BARRIER)
+        return 1;
+    
+    /*! A launch touches each of its buffers, only those pairs count */
+    for(i = 0; i < earlier->numAccess; i++){
+        for(j = 0; j < later->numAccess; j++){
+            if((earlier->access[i].write || later->access[j].write) && 
+               earlier->access[i].start < later->access[j].end && 
+               later->access[j].start < earlier->access[i].end)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/*! 
+* @brief Whether the device keeps two dependent commands in order by itself.
+*        A queue's session handles requests in the order they arrive and 
+*        holds memory accesses back until the kernels they overlap are 
+*        done, so a transfer or launch only has to be sent after the ones 
+*        it depends on, not wait for their answers. Anything involving the
+*        host's side of a command still waits for completion.
+*/
+static int queue_device_command(QueueCommand *command){
+    static const cl_command_type device_commands[] = {
+        CL_COMMAND_READ_BUFFER, CL_COMMAND_WRITE_BUFFER, 
+        CL_COMMAND_MAP_BUFFER, CL_COMMAND_NDRANGE_KERNEL
+    };
+    int i;
+    
+    for(i = 0; i < (int)(sizeof(device_commands) / sizeof(device_commands[0])); i++){
+        if(command->commandType == device_commands[i]) return 1;
+    }
+    return 0;
+}
+
+static int queue_device_ordered(QueueCommand *earlier, QueueCommand *later){
+    return queue_device_command(earlier) && queue_device_command(later);
+}
+
+/*! 
+* @brief Whether a command enqueued after another has to wait for it: for 
+*        its completion, or only for it to be sent when the device orders 
+*        the two. Must be called with the queue mutex held.
+*/
+static int queue_depends(cl_command_queue command_queue, QueueCommand *earlier, QueueCommand *later){
+    return queue_conflicts(command_queue, earlier, later) && 
+           !(earlier->sent && queue_device_ordered(earlier, later));
+}
+
+/*! 
+* @brief Called when an event in the wait list of a command terminates
+*/
+static void CL_CALLBACK queue_event_done(cl_event event, cl_int status, void *user_data){
+    QueueCommand *command = (QueueCommand *)user_data;
+    cl_command_queue queue = command->event->queue;
+    
+    pthread_mutex_lock(&(queue->queue_mutex));
+    if(status < 0){
+        command->depStatus = CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+    }
+    if(--command->pending == 0){
+        queue->numReady++;
+        pthread_cond_signal(&(queue->queue_cond));
+    }
+    pthread_mutex_unlock(&(queue->queue_mutex));
+}
+
+/*! 
+* @brief Record the completion of a command and release the commands that 
+*        were waiting for it. Must be called with the queue mutex held.
+* @param queue Command queue object
+* @param command Pointer to command
+* @param status CL_COMPLETE or the error the command terminated with
+*/
+static void queue_complete(cl_command_queue queue, QueueCommand *command, cl_int status){
+    QueueCommand *qpos;
+    QueueCommand *last;
+    
+    command->eventStatus = status;
+    queue->outstanding--;
+    
+    /*! Everything enqueued after this command counted it if they conflict, 
+     *  unless sending it already let them go. On an in-order queue that is
+     *  only the next one, and the gate if it is further on. */
+    last = NULL;
+    if(!(queue->props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) && command->next){
+        last = command->next->next;
+        if(command->gate && command->gate != command->next && --command->gate->pending == 0){
+            queue->numReady++;
+        }
+    }
+    for(qpos = command->next; qpos != last; qpos = qpos->next){
+        if(qpos->eventStatus == CL_QUEUED && queue_depends(queue, command, qpos)){
+            if(--qpos->pending == 0){
+                queue->numReady++;
+            }
+        }
+    }
+    if(queue->numReady || queue->outstanding == 0){
+        pthread_cond_broadcast(&(queue->queue_cond));
+    }
+    pthread_cond_broadcast(&(queue->done_cond));
+    
+    /*! Anyone still interested holds the event, the command is recycled */
+    queue_remove(queue, command);
+}
+
+/*! 
+* @brief Record that a command is on the wire and release the commands the 
+*        device keeps in order behind it. Must be called with the queue 
+*        mutex held.
+* @param queue Command queue object
+* @param command Pointer to command
+*/
+static void queue_sent(cl_command_queue queue, QueueCommand *command){
+    QueueCommand *qpos;
+    QueueCommand *last;
+    
+    last = NULL;
+    if(!(queue->props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) && command->next){
+        last = command->next->next;
+    }
+    for(qpos = command->next; qpos != last; qpos = qpos->next){
+        if(qpos->eventStatus == CL_QUEUED && queue_conflicts(queue, command, qpos) && 
+           queue_device_ordered(command, qpos)){
+            if(--qpos->pending == 0){
+                queue->numReady++;
+            }
+        }
+    }
+    command->sent = 1;
+    if(queue->numReady){
+        pthread_cond_broadcast(&(queue->queue_cond));
+    }
+}
+
+/*! 
+* @brief Complete a command the device has answered. Called from the 
+*        receiver thread; if the dispatch thread has not marked the command
+*        sent yet, completing it is left to that thread.
+* @param queue Command queue object
+* @param command Pointer to command
+* @param status CL_COMPLETE or the error the command terminated with
+*/
+static void queue_answered(cl_command_queue queue, QueueCommand *command, cl_int status){
+    event_set_status(command->event, status);
+    pthread_mutex_lock(&(queue->queue_mutex));
+    if(command->sent){
+        queue_complete(queue, command, status);
+    }else{
+        command->replied = 1;
+        command->replyStatus = status;
+    }
+    pthread_mutex_unlock(&(queue->queue_mutex));
+}
+
 void *queue_worker(void *arg){
     cl_command_queue queue = (cl_command_queue)arg; 
-    time_t now;
-    QueueCommand *qpos;
+    QueueCommand *command;
+    cl_int status;
         
     /*! Sanity check */
     if(queue == NULL) return NULL;
     
     DEBUG("%s %p\n", __func__, arg);
-    /*!Keep queue alive if reference count is not zero*/
-    while(queue->refcount){
-        pthread_mutex_lock(&(queue->queue_mutex));
-        if(queue->currentEvent != NULL){
-            queue_dispatchCommand(queue, queue->currentEvent);
-            queue->currentEvent = queue->currentEvent->next;
-            DEBUG("%s Next event -> %p \n", __func__, queue->currentEvent);
+    pthread_mutex_lock(&(queue->queue_mutex));
+    /*!Keep queue alive until it is released and drained*/
+    while(1){
+        queue_wait(queue, &(queue->queue_cond), queue_has_work, NULL, 
+                   &(queue->worker_wait_ns));
+        
+        /*! Oldest command that has nothing left to wait for */
+        command = queue->queue;
+        while(command && (command->eventStatus != CL_QUEUED || command->pending)){
+            command = command->next;
         }
-        time(&now);
+        if(command == NULL) break;
+        command->eventStatus = CL_SUBMITTED;
+        queue->numReady--;
+        DEBUG("%s Running event %p \n", __func__, command);
         
-        qpos = queue->queue;
-        while(qpos && qpos->eventStatus == CL_COMPLETE){
-            if((now - qpos->completionTime) >= EVENT_EXPIRY_TIME_S){
-                //Completed and expired.
-                queue_remove(queue, qpos);
+        /*! Sent without the lock so that host threads can keep enqueueing.
+         *  Requests on the wire are completed by the receiver thread, the 
+         *  next command goes out without waiting for the answer. */
+        pthread_mutex_unlock(&(queue->queue_mutex));
+        status = command->depStatus;
+        if(status == CL_SUCCESS){
+            event_set_status(command->event, CL_SUBMITTED);
+            status = queue_dispatchCommand(queue, command);
+        }
+        if(status == CL_SUCCESS){
+            status = CL_COMPLETE;
+        }
+        if(status != QUEUE_SENT){
+            event_set_status(command->event, status);
+        }
+        pthread_mutex_lock(&(queue->queue_mutex));
+        
+        if(status != QUEUE_SENT){
+            queue_complete(queue, command, status);
+        }else{
+            queue_sent(queue, command);
+            if(command->replied){
+                queue_complete(queue, command, command->replyStatus);
             }
-            qpos = qpos->next;
         }
-        pthread_mutex_unlock(&(queue->queue_mutex));
-        usleep(1);
     }
+    pthread_mutex_unlock(&(queue->queue_mutex));
     DEBUG("%s %p Joining\n", __func__, arg);
     return NULL;
 }
 
-void queue_dispatchCommand(cl_command_queue command_queue, QueueCommand *command){
-    int fd;
-    char cmdRsp[64*1024];
-    int reqLength;
-    int rspLength;
-    int retLength;
+/*! 
+* @brief Give a request the next id and put it in the window, waiting while 
+*        the window is full. Must be called with the connection mutex held,
+*        just before the request is sent.
+* @param command_queue Command queue object
+* @param reply Filled in by the receiver, stays with the caller until answered
+* @param kind What the device answers with
+* @return 1 if the request may be sent, 0 if the connection is lost
+*/
+static int reply_expect(cl_command_queue command_queue, DeviceReply *reply, int kind){
+    DeviceReply **slot;
+    int ok;
+    
+    reply->kind = kind;
+    pthread_mutex_lock(&(command_queue->reply_mutex));
+    slot = &(command_queue->inflight[command_queue->nextId % QUEUE_WINDOW]);
+    while(*slot != NULL && !command_queue->connLost){
+        pthread_cond_wait(&(command_queue->reply_cond), &(command_queue->reply_mutex));
+    }
+    ok = !command_queue->connLost;
+    if(ok){
+        reply->id = command_queue->nextId++;
+        *slot = reply;
+    }
+    pthread_mutex_unlock(&(command_queue->reply_mutex));
+    return ok;
+}
+
+/*! 
+* @brief A request could not be sent in full. The stream is out of step with 
+*        the device from here on, so the connection is dropped; the receiver
+*        then fails everything still in the window.
+*/
+static void reply_send_failed(cl_command_queue command_queue){
+    shutdown(command_queue->fd_ctrl, SHUT_RDWR);
+}
+
+/*! 
+* @brief Look a kernel image up among those the queue's device session 
+*        holds, marking it used last. The session lets go of the images used
+*        longest ago, counting offers, uploads and launches the way this 
+*        does, so it still holds the QUEUE_KERNELS used last here.
+* @param command_queue Command queue object
+* @param hash Image hash
+* @param hold Add the image if it is not there
+* @return 1 if the session held the image already, 0 if not
+*/
+static int queue_kernel_use(cl_command_queue command_queue, uint64_t hash, int hold){
+    uint64_t *kernels = command_queue->kernels;
+    int i, held;
+    
+    pthread_mutex_lock(&(command_queue->reply_mutex));
+    for(i = 0; i < command_queue->kernelCount && kernels[i] != hash; i++);
+    held = i < command_queue->kernelCount;
+    if(held || hold){
+        if(!held && command_queue->kernelCount < QUEUE_KERNELS){
+            command_queue->kernelCount++;
+        }
+        if(i == QUEUE_KERNELS){
+            i--;
+        }
+        memmove(kernels + 1, kernels, i * sizeof(uint64_t));
+        kernels[0] = hash;
+    }
+    pthread_mutex_unlock(&(command_queue->reply_mutex));
+    return held;
+}
+
+/*! Forget a kernel image the session could not load */
+static void queue_kernel_forget(cl_command_queue command_queue, uint64_t hash){
+    uint64_t *kernels = command_queue->kernels;
+    int i;
+    
+    pthread_mutex_lock(&(command_queue->reply_mutex));
+    for(i = 0; i < command_queue->kernelCount && kernels[i] != hash; i++);
+    if(i < command_queue->kernelCount){
+        command_queue->kernelCount--;
+        memmove(kernels + i, kernels + i + 1, (command_queue->kernelCount - i) * sizeof(uint64_t));
+    }
+    pthread_mutex_unlock(&(command_queue->reply_mutex));
+}
+
+/*! Looks up the request an answer is for. Must be called with the reply mutex held. */
+static DeviceReply *reply_find(cl_command_queue queue, uint32_t id){
+    DeviceReply *reply = queue->inflight[id % QUEUE_WINDOW];
+    
+    return (reply && reply->id == id) ? reply : NULL;
+}
+
+/*! 
+* @brief Take an answered request out of the window and complete what it 
+*        was for. Called from the receiver thread only.
+* @param ok Whether the device carried the request out
+*/
+static void reply_finish(cl_command_queue queue, DeviceReply *reply, int ok){
+    int kind = reply->kind;
+    
+    pthread_mutex_lock(&(queue->reply_mutex));
+    queue->inflight[reply->id % QUEUE_WINDOW] = NULL;
+    /*! The sender waits for this one, and owns it again once answered */
+    if(kind == REPLY_OFFER){
+        reply->answer = ok ? 1 : -1;
+    }
+    pthread_cond_broadcast(&(queue->reply_cond));
+    pthread_mutex_unlock(&(queue->reply_mutex));
+    
+    if(kind == REPLY_OFFER){
+        return;
+    }
+    if(reply->kind == REPLY_LOAD){
+        /*! The session dropped it, the next launch of that kernel offers it again */
+        if(!ok){
+            DEBUG("%s: Device error while loading kernel.\n", __func__);
+            queue_kernel_forget(queue, reply->imageHash);
+        }
+        free(reply);
+        return;
+    }
+    queue_answered(queue, reply->command, ok ? CL_COMPLETE : CL_OUT_OF_RESOURCES);
+}
+
+/*! Reads and drops bytes of a packet nobody needs */
+static int reply_skip(int fd, size_t count){
+    char scratch[64];
+    size_t chunk;
+    
+    while(count > 0){
+        chunk = (count > sizeof(scratch)) ? sizeof(scratch) : count;
+        if(dev_read(fd, scratch, chunk) < 0){
+            return 0;
+        }
+        count -= chunk;
+    }
+    return 1;
+}
+
+/*! 
+* @brief Receiver thread of a queue. It reads everything the device sends 
+*        and completes the request each answer is for, matched by id, so 
+*        dispatch threads only hold the connection while sending and can 
+*        keep a window of requests on the wire. Stops when the connection 
+*        ends, failing whatever is still in the window.
+* @param arg Command queue object
+*/
+void *queue_receiver(void *arg){
+    cl_command_queue queue = (cl_command_queue)arg;
+    int fd = queue->fd_ctrl;
+    CommPacket_t header;
+    KernelDone_t done;
+    DeviceReply *reply;
+    size_t payload;
+    ssize_t rcount;
+    uint64_t chunkOffset, chunk;
+    cl_ulong recvTime;
+    int64_t offset;
+    uint32_t i;
+    int ok = 1;
+    
+    while(ok){
+        /*! The end of the stream is how a released queue stops us */
+        rcount = recv(fd, &header, COMM_HEADER_LENGTH, MSG_WAITALL);
+        if(rcount < 0 && errno == EINTR){
+            continue;
+        }
+        if(rcount <= 0){
+            break;
+        }
+        if(rcount < COMM_HEADER_LENGTH && 
+           dev_read(fd, (char *)&header + rcount, COMM_HEADER_LENGTH - rcount) < 0){
+            break;
+        }
+        if(ntohl(header.length) < COMM_HEADER_LENGTH){
+            break;
+        }
+        payload = ntohl(header.length) - COMM_HEADER_LENGTH;
+        /*! Only this thread takes requests out of the window */
+        pthread_mutex_lock(&(queue->reply_mutex));
+        reply = reply_find(queue, ntohl(header.id));
+        pthread_mutex_unlock(&(queue->reply_mutex));
+        if(reply == NULL){
+            DEBUG("%s: Answer to unknown request %u.\n", __func__, ntohl(header.id));
+            break;
+        }
+        
+        switch(header.cmdId){
+            case CTRL_ACK:
+            case CTRL_NAK:
+                if(!reply_skip(fd, payload)){
+                    ok = 0;
+                    break;
+                }
+                /*! An accepted launch is queued, done comes later; a read 
+                 *  is only ever refused this way */
+                if(reply->kind == REPLY_READ && header.cmdId == CTRL_ACK){
+                    ok = 0;
+                }else if(reply->kind != REPLY_LAUNCH || header.cmdId == CTRL_NAK){
+                    reply_finish(queue, reply, header.cmdId == CTRL_ACK);
+                }
+                break;
+                
+            case MEM_READ_RSP_CMD:
+                if(reply->kind != REPLY_READ || payload < sizeof(MemReadWrite_t) ||
+                   dev_read(fd, &(header.payload.read), sizeof(MemReadWrite_t)) < 0){
+                    ok = 0;
+                    break;
+                }
+                chunkOffset = be64toh(header.payload.read.offset) - reply->offset;
+                chunk = be64toh(header.payload.read.accessLength);
+                if(chunk != payload - sizeof(MemReadWrite_t) || 
+                   chunkOffset > reply->length || chunk > reply->length - chunkOffset){
+                    DEBUG("%s: Chunk outside the requested range.\n", __func__);
+                    ok = 0;
+                    break;
+                }
+                /*! Straight into the caller's buffer */
+                if(dev_read(fd, (char *)reply->data + chunkOffset, chunk) < 0){
+                    ok = 0;
+                    break;
+                }
+                if(!(ntohs(header.flags) & MORACL_FLAG_MORE)){
+                    reply_finish(queue, reply, 1);
+                }
+                break;
+                
+            case KERNEL_DONE:
+                if(reply->kind != REPLY_LAUNCH || payload < sizeof(KernelDone_t) || 
+                   dev_read(fd, &done, sizeof(done)) < 0 || !reply_skip(fd, payload - sizeof(done))){
+                    ok = 0;
+                    break;
+                }
+                recvTime = event_clock();
+                /*! Symmetric link delay: the device clock runs offset ahead of ours */
+                offset = ((int64_t)(be64toh(done.timing.received) - reply->sendTime) + 
+                          (int64_t)(be64toh(done.timing.sent) - recvTime)) / 2;
+                event_set_device_times(reply->command->event, be64toh(done.timing.start) - offset, 
+                                       be64toh(done.timing.end) - offset);
+                reply_finish(queue, reply, ntohl(done.status) == 0);
+                break;
+                
+            default:
+                DEBUG("%s: Unexpected packet 0x%02x.\n", __func__, header.cmdId);
+                ok = 0;
+                break;
+        }
+    }
+    
+    /*! Senders see connLost before anything in the window is failed, so 
+     *  nothing new gets in behind */
+    pthread_mutex_lock(&(queue->reply_mutex));
+    queue->connLost = 1;
+    pthread_cond_broadcast(&(queue->reply_cond));
+    pthread_mutex_unlock(&(queue->reply_mutex));
+    for(i = 0; i < QUEUE_WINDOW; i++){
+        pthread_mutex_lock(&(queue->reply_mutex));
+        reply = queue->inflight[i];
+        pthread_mutex_unlock(&(queue->reply_mutex));
+        if(reply){
+            reply_finish(queue, reply, 0);
+        }
+    }
+    DEBUG("%s %p stopped\n", __func__, arg);
+    return NULL;
+}
+
+/*! 
+* @brief Stream a buffer to the device in chunks. Only the last chunk is 
+*        answered, so the chunks follow each other without round trips.
+* @param command_queue Command queue object
+* @param command Completed when the device has the data
+* @param offset Device address of the first byte
+* @param data Bytes to write
+* @param length Number of bytes
+* @return QUEUE_SENT, or an error code if nothing could be sent
+*/
+static cl_int queue_write_chunks(cl_command_queue command_queue, QueueCommand *command, 
+                                 uint64_t offset, const void *data, uint64_t length){
+    CommPacket_t header;
+    struct iovec iov[2];
+    uint64_t sent = 0;
+    uint64_t chunk;
+    
+    header.version = MORACL_PROTOCOL_VERSION;
+    header.cmdId = MEM_WRITE_CMD;
+    command->reply.command = command;
+    pthread_mutex_lock(&(command_queue->conn_mutex));
+    if(!reply_expect(command_queue, &(command->reply), REPLY_ACK)){
+        pthread_mutex_unlock(&(command_queue->conn_mutex));
+        return CL_OUT_OF_RESOURCES;
+    }
+    header.id = htonl(command->reply.id);
+    do{
+        chunk = (length - sent > MORACL_CHUNK_SIZE) ? MORACL_CHUNK_SIZE : length - sent;
+        header.flags = htons((sent + chunk < length) ? MORACL_FLAG_MORE : 0);
+        header.length = htonl(COMM_HEADER_LENGTH + sizeof(MemReadWrite_t) + chunk);
+        header.payload.write.offset = htobe64(offset + sent);
+        header.payload.write.accessLength = htobe64(chunk);
+        /*! Header from the stack, data from wherever the caller keeps it */
+        iov[0].iov_base = &header;
+        iov[0].iov_len = COMM_HEADER_LENGTH + sizeof(MemReadWrite_t);
+        iov[1].iov_base = (char *)data + sent;
+        iov[1].iov_len = chunk;
+        if(dev_writev(command_queue->fd_ctrl, iov, 2) < 0){
+            reply_send_failed(command_queue);
+            break;
+        }
+        sent += chunk;
+    }while(sent < length);
+    pthread_mutex_unlock(&(command_queue->conn_mutex));
+    
+    return QUEUE_SENT;
+}
+
+/*! 
+* @brief Read a buffer back from the device. The device answers with as 
+*        many chunks as it likes; the receiver puts each one directly in the
+*        caller's buffer.
+* @param command_queue Command queue object
+* @param command Completed when the last chunk is in
+* @param offset Device address of the first byte
+* @param data Destination
+* @param length Number of bytes
+* @return QUEUE_SENT, or an error code if nothing could be sent
+*/
+static cl_int queue_read_chunks(cl_command_queue command_queue, QueueCommand *command, 
+                                uint64_t offset, void *data, uint64_t length){
+    CommPacket_t request;
+    const int hdrlen = COMM_HEADER_LENGTH + sizeof(MemReadWrite_t);
+    
+    command->reply.command = command;
+    command->reply.data = data;
+    command->reply.offset = offset;
+    command->reply.length = length;
+    request.version = MORACL_PROTOCOL_VERSION;
+    request.cmdId = MEM_READ_CMD;
+    request.flags = 0;
+    request.length = htonl(hdrlen);
+    request.payload.read.offset = htobe64(offset);
+    request.payload.read.accessLength = htobe64(length);
+    pthread_mutex_lock(&(command_queue->conn_mutex));
+    if(!reply_expect(command_queue, &(command->reply), REPLY_READ)){
+        pthread_mutex_unlock(&(command_queue->conn_mutex));
+        return CL_OUT_OF_RESOURCES;
+    }
+    request.id = htonl(command->reply.id);
+    if(dev_write(command_queue->fd_ctrl, &request, hdrlen) < 0){
+        reply_send_failed(command_queue);
+    }
+    pthread_mutex_unlock(&(command_queue->conn_mutex));
     
-    fd = command_queue->device->fd_ctrl;
+    return QUEUE_SENT;
+}
+
+/*! 
+* @brief Execute a command on the device. Called from the queue thread.
+* @param command_queue Command queue object
+* @param command Pointer to command
+* @return QUEUE_SENT once a device command is on the wire, CL_SUCCESS for 
+*         commands done here, or an error code the command's event completes with
+*/
+cl_int queue_dispatchCommand(cl_command_queue command_queue, QueueCommand *command){
+    cl_int status = CL_SUCCESS;
     CommPacket_t *payload = (CommPacket_t *)command->payload;
-    CommPacket_t *readRspPacket = (CommPacket_t *)cmdRsp;
+    
+    /*! Kernels are only running once the device has accepted them */
+    if(command->commandType != CL_COMMAND_NDRANGE_KERNEL){
+        event_set_status(command->event, CL_RUNNING);
+    }
     switch(command->commandType){
         case CL_COMMAND_READ_BUFFER:
+        case CL_COMMAND_MAP_BUFFER:
             DEBUG("%s: Submitting Read buffer.\n", __func__);
-            reqLength = ntohs(payload->length);
-            DEBUG("%s: Read PKG 1 %d\n", __func__, reqLength);
-            retLength = ntohl(payload->payload.read.accessLength); /*! Expected return length */
-            DEBUG("%s: Read 1 %d\n", __func__, retLength);
-            rspLength = 4 + 8 + retLength;
-            dev_write(fd, command->payload, reqLength);
-            dev_read(fd, cmdRsp, rspLength);
-            if(command->ret){
-                DEBUG("%s: Read %d\n", __func__, retLength);
-                memcpy(command->ret, readRspPacket->payload.read.data, retLength);
-            }
+            status = queue_read_chunks(command_queue, command, be64toh(payload->payload.read.offset), 
+                                       command->ret, be64toh(payload->payload.read.accessLength));
             DEBUG("%s: Submitting Read buffer. Return\n", __func__);
             break;
             
         case CL_COMMAND_WRITE_BUFFER:
             DEBUG("%s: Submitting Write buffer.\n", __func__);
-            reqLength = ntohs(payload->length);
-            rspLength = 4; //Ack or Nak
-            dev_write(fd, command->payload, reqLength);
-            
-            dev_read(fd, cmdRsp, rspLength);
+            status = queue_write_chunks(command_queue, command, be64toh(payload->payload.write.offset), 
+                                        command->ret, be64toh(payload->payload.write.accessLength));
             DEBUG("%s: Submitting Write buffer. Return\n", __func__);
-            //TODO Set error based on ACK or NAK
             break;
         
         case CL_COMMAND_NDRANGE_KERNEL:
             DEBUG("%s: Submitting NDRange Kernel.\n", __func__);
-            dispatchNDRangeKernel(command_queue->device, command);
+            status = dispatchNDRangeKernel(command_queue, command);
             DEBUG("%s: Submitting NDRange Kernel. Return\n", __func__);
             break;
             
-        case CL_COMMAND_MAP_BUFFER:
-            DEBUG("%s: Submitting Map (Read) buffer.\n", __func__);
-            reqLength = ntohs(payload->length);
-            DEBUG("%s: Read PKG 1 %d\n", __func__, reqLength);
-            retLength = ntohl(payload->payload.read.accessLength); /*! Expected return length */
-            DEBUG("%s: Read 1 %d\n", __func__, retLength);
-            rspLength = 4 + 8 + retLength;
-            dev_write(fd, command->payload, reqLength);
-            dev_read(fd, cmdRsp, rspLength);
-            if(command->ret){
-                DEBUG("%s: Read %d\n", __func__, retLength);
-                memcpy(command->ret, readRspPacket->payload.read.data, retLength);
-            }
-            DEBUG("%s: Submitting Map buffer. Return\n", __func__);
-            break;
-            
         case CL_COMMAND_UNMAP_MEM_OBJECT:
             DEBUG("%s: UnMap Memory object.\n", __func__);
             if(command->ret){
@@ -299,6 +1017,9 @@ void queue_dispatchCommand(cl_command_queue command_queue, QueueCommand *command
         case CL_CUSTOM_COMMAND_BARRIER:
             DEBUG("%s: Barrier command.\n", __func__);
             break;
+        case CL_COMMAND_MARKER:
+            DEBUG("%s: Marker command.\n", __func__);
+            break;
         case CL_COMMAND_TASK:
         case CL_COMMAND_NATIVE_KERNEL:
         case CL_COMMAND_COPY_BUFFER:
@@ -307,7 +1028,6 @@ void queue_dispatchCommand(cl_command_queue command_queue, QueueCommand *command
         case CL_COMMAND_COPY_BUFFER_TO_IMAGE:
         case CL_COMMAND_MAP_IMAGE:
 
-        case CL_COMMAND_MARKER:
         case CL_COMMAND_ACQUIRE_GL_OBJECTS:
         case CL_COMMAND_RELEASE_GL_OBJECTS:
         case CL_COMMAND_READ_BUFFER_RECT:
@@ -320,313 +1040,650 @@ void queue_dispatchCommand(cl_command_queue command_queue, QueueCommand *command
             DEBUG("%s: Command 0x%04x unknown.\n", __func__, command->commandType);
             break;
     }
-    command->eventStatus = CL_COMPLETE;
-    time(&(command->completionTime));
+    return status;
 }
 
-void dispatchNDRangeKernel(cl_device_id device, QueueCommand *command){
-    DEBUG("%s: Entered \n", __func__);
-    ND_Kernel_Cmd_Params *params = command->payload;
-    int fd = device->fd_ctrl;
+static const char *kernel_files[] = {"kernel.so", NULL};
+
+/*!
+* @brief Hash a kernel image the way the device does, FNV-1a over its bytes
+* @return 1 on success, 0 if the image cannot be read
+*/
+static int image_hash(const char *path, uint64_t *hash, cl_uint *size){
+    unsigned char buf[4096];
+    FILE *image = fopen(path, "rb");
+    size_t count, i;
     
-    if(!setGlobalWorkSize(fd, params->globalWorkSize.globalX, params->globalWorkSize.globalY, params->globalWorkSize.globalZ)){
-        DEBUG("Error setting Kernel arguments.\n");
-        time(&(command->completionTime));
-        command->eventStatus = CL_COMPLETE;
-        return;
+    if(image == NULL){
+        return 0;
     }
-    
-    if(!setKernelArguments(params->kernel)){
-        DEBUG("Error setting Kernel arguments.\n");
-        time(&(command->completionTime));
-        command->eventStatus = CL_COMPLETE;
-        return;
+    *hash = 0xcbf29ce484222325ULL;
+    *size = 0;
+    while((count = fread(buf, 1, sizeof(buf), image)) > 0){
+        for(i = 0; i < count; i++){
+            *hash ^= buf[i];
+            *hash *= 0x100000001b3ULL;
+        }
+        *size += count;
     }
-    
-    if(params->kernel->isNew == CL_TRUE){
-        if(!compileKernel(params->kernel->func_name, params->globalWorkSize.globalX, params->globalWorkSize.globalY, params->globalWorkSize.globalZ)){
+    count = ferror(image);
+    fclose(image);
+    return !count;
+}
+
+/*!
+* @brief Produce kernel.so in a directory of the kernel's own, from the build 
+*        cache when an image for the same program, kernel and arguments is 
+*        there. Kernels of different programs build in parallel, those of one
+*        program one at a time.
+* @return CL_SUCCESS, or an error code the command's event completes with
+*/
+static cl_int buildKernel(cl_kernel kernel){
+    cl_program program = kernel->program;
+    char path[PATH_MAX];
+    char *dir;
+    char *args;
+    CacheKey key;
+    cl_int status = CL_SUCCESS;
+
+    pthread_mutex_lock(&(program->build_mutex));
+    if(kernel->buildDir != NULL){
+        pthread_mutex_unlock(&(program->build_mutex));
+        return CL_SUCCESS;
+    }
+    if((dir = build_dir_create()) == NULL){
+        pthread_mutex_unlock(&(program->build_mutex));
+        return CL_OUT_OF_RESOURCES;
+    }
+
+    cache_key_init(&key, "kernel");
+    cache_key_add(&key, KERNEL_WRAPPER_ABI);
+    cache_key_add(&key, kernel->func_name);
+    if((args = get_kernel_args(kernel)) != NULL){
+        cache_key_add(&key, args);
+        free(args);
+    }
+    cache_key_add(&key, program->buildOptions);
+    snprintf(path, sizeof(path), "%s/%s", program->buildDir, kernel->hasSignature ? "program.i" : "program.o");
+    cache_key_add_file(&key, path);
+    snprintf(path, sizeof(path), "%s/kernel.so", dir);
+
+    if(!cache_lookup(&key, dir, kernel_files)){
+        if(!compileKernel(kernel, dir)){
             DEBUG("Error compiling kernel \n");
-            time(&(command->completionTime));
-            command->eventStatus = CL_COMPLETE;
-            return;
-        }
-        if(!transferKernel(fd)){
-            DEBUG("Error transferring kernel.\n");
-            time(&(command->completionTime));
-            command->eventStatus = CL_COMPLETE;
-            return;
+            status = CL_INVALID_PROGRAM_EXECUTABLE;
+        }else{
+            cache_store(&key, dir, kernel_files);
         }
-        params->kernel->isNew = CL_FALSE;
     }
+    cache_key_free(&key);
     
-    if(!sendExecuteKernel(fd)){
-        DEBUG("Error starting kernel.\n");
-        time(&(command->completionTime));
-        command->eventStatus = CL_COMPLETE;
-        return;
+    /*! Images from the cache hash the same, the device may hold them already */
+    if(status == CL_SUCCESS && !image_hash(path, &(kernel->imageHash), &(kernel->imageSize))){
+        status = CL_OUT_OF_RESOURCES;
     }
-    // TODO Set Error
-    time(&(command->completionTime));
-    command->eventStatus = CL_COMPLETE;
-    return;
-}
-
-int setGlobalWorkSize(int fd, int globalX, int globalY, int globalZ){
-        /*! Set Global size */
-    char buf[256];
-    CommPacket_t *globalWorkSize = (CommPacket_t *)buf;
-    CommPacket_t *rsp = (CommPacket_t *)buf;
-    globalWorkSize->version = MORACL_PROTOCOL_VERSION;
-    globalWorkSize->cmdId = GLOBAL_WORK_SIZE;
-    globalWorkSize->length = htons(4 + 12);
-    globalWorkSize->payload.globalWorkSize.globalX = htonl(globalX);
-    globalWorkSize->payload.globalWorkSize.globalY = htonl(globalY);
-    globalWorkSize->payload.globalWorkSize.globalZ = htonl(globalZ);
-    dev_write(fd, buf, (4+12));
-    dev_read(fd, buf, 4);
-    if(rsp->cmdId == CTRL_ACK){
-        DEBUG("%s: Global work size set.\n", __func__);
-        return 1;
-    }else if(rsp->cmdId != CTRL_NAK){
-        DEBUG("%s: Device response protocol error.\n", __func__);
-        return 0;
+
+    if(status == CL_SUCCESS){
+        kernel->buildDir = dir;
     }else{
-        DEBUG("%s: Device error while setting global work size.\n", __func__);
-        return 0;
+        build_dir_remove(dir);
+        free(dir);
     }
+    pthread_mutex_unlock(&(program->build_mutex));
+    return status;
 }
 
-int setKernelArguments(cl_kernel kernel){
-    char* args;
-    /* set kernel args on the device */
-    args = get_kernel_args(kernel);
-    dev_set_kernel_args(args);
-    free(args);
-    return 1;
+/*! 
+* @brief Build, load and launch a kernel. The image is only uploaded when the
+*        queue's device session does not hold it already, and then only if
+*        the device does not have it cached either. A session holds several
+*        kernels, so alternating between them costs nothing; building is done before
+*        taking the device connection. Neither the upload nor the 
+*        launch is waited for: the device takes a session's requests in 
+*        order, and the receiver completes the command when the kernel is done.
+* @param command_queue Command queue object
+* @param command Pointer to command
+* @return QUEUE_SENT, or an error code the command's event completes with
+*/
+cl_int dispatchNDRangeKernel(cl_command_queue command_queue, QueueCommand *command){
+    DEBUG("%s: Entered \n", __func__);
+    ND_Kernel_Cmd_Params *params = command->payload;
+    char image[PATH_MAX];
+    cl_int status;
+    
+    /*! A built image is never rewritten, so it can be sent without the build lock */
+    if((status = buildKernel(params->kernel)) != CL_SUCCESS){
+        return status;
+    }
+    snprintf(image, sizeof(image), "%s/kernel.so", params->kernel->buildDir);
+    
+    pthread_mutex_lock(&(command_queue->conn_mutex));
+    if(!queue_kernel_use(command_queue, params->kernel->imageHash, 0)){
+        if(!offerKernel(command_queue, params->kernel) &&
+           !transferKernel(command_queue, params->kernel, image)){
+            DEBUG("Error transferring kernel.\n");
+            pthread_mutex_unlock(&(command_queue->conn_mutex));
+            return CL_OUT_OF_RESOURCES;
+        }
+        queue_kernel_use(command_queue, params->kernel->imageHash, 1);
+    }
+    event_set_status(command->event, CL_RUNNING);
+    if(!sendLaunchKernel(command_queue, command)){
+        DEBUG("Error starting kernel.\n");
+        status = CL_OUT_OF_RESOURCES;
+    }
+    pthread_mutex_unlock(&(command_queue->conn_mutex));
+    
+    return (status == CL_SUCCESS) ? QUEUE_SENT : status;
 }
 
-int compileKernel(char * func_name, int globalX, int globalY, int globalZ){
-    /*! Compile kernel*/
-    char cmd[256];
+/*!
+* @brief Compile dir/kernel.so with a generated wrapper. The wrapper gives the
+*        device a fixed entry point, kernel_wrapper, which runs the kernel 
+*        over a range of work items. It picks each argument out of the 
+*        launch's argument block once, turning buffer offsets into pointers 
+*        into device memory, then loops over the range. It is compiled 
+*        together with the program's preprocessed source, so the kernel's 
+*        parameter types are in scope and the kernel can be inlined into the
+*        loop; kernels without a signature are linked against program.o 
+*        instead. Only kernel_wrapper is exported. The source is piped 
+*        straight into the compiler. Images are cached under 
+*        KERNEL_WRAPPER_ABI, so bump it along with any change made here.
+* @return 1 on success, 0 on error
+*/
+int compileKernel(cl_kernel kernel, const char *dir){
+    cl_program program = kernel->program;
+    size_t offsets[KERNEL_MAX_ARGS];
+    char cmd[3 * PATH_MAX];
+    char buf[4096];
+    KernelArg *arg;
+    FILE *cc;
+    FILE *src = NULL;
+    size_t count;
+    unsigned int i;
+    int ret;
 
     DEBUG("clEnqueueNDRangeKernel: performing kernel compilation\n");
-    /* create kernel wrapper from kernelargs and compile the kernel */
-    snprintf(cmd, 256, "%s $NOVELCLSDKROOT/scripts/createwrapper.py %s %d %d && $NOVELCLSDKROOT/scripts/compilekernel.sh %s.cl", PYTHON, func_name, globalX, globalY, func_name); 
+    if(kernel->hasSignature){
+        snprintf(cmd, sizeof(cmd), "%s/program.i", program->buildDir);
+        if((src = fopen(cmd, "rb")) == NULL){
+            return 0;
+        }
+        snprintf(cmd, sizeof(cmd), "gcc -fPIC -shared -fvisibility=hidden -Wno-implicit-function-declaration -g -O2 -std=c99 %s "
+                 "-o '%s/kernel.so' -x c -", program->buildOptions ? program->buildOptions : "", dir);
+    }else{
+        snprintf(cmd, sizeof(cmd), "gcc -fPIC -shared -fvisibility=hidden -Wno-implicit-function-declaration -g -O2 -std=c99 "
+                 "-o '%s/kernel.so' -x c - -x none '%s/program.o'", dir, program->buildDir);
+    }
+    cc = popen(cmd, "w");
+    if(cc == NULL){
+        DEBUG("clEnqueueNDRangeKernel: cannot run the compiler\n");
+        if(src) fclose(src);
+        return 0;
+    }
+    if(src){
+        while((count = fread(buf, 1, sizeof(buf), src)) > 0){
+            fwrite(buf, 1, count, cc);
+        }
+        fclose(src);
+    }else{
+        /*! What kernel.h gives the program: the work-item context, and 
+         *  the builtins for objects built before they were inline */
+        fprintf(cc, "#include <stddef.h>\n#include <stdint.h>\nvoid %s();\n"
+                    "typedef struct {\nsize_t global_id[3];\nsize_t global_size[3];\nsize_t global_offset[3];\n"
+                    "} novelcl_context_t;\n"
+                    "extern __thread novelcl_context_t novelcl_context __attribute__((tls_model(\"initial-exec\")));\n"
+                    "size_t get_global_id(unsigned int d){\nreturn (d < 3)?novelcl_context.global_id[d]:0;\n}\n"
+                    "size_t get_global_size(unsigned int d){\nreturn (d < 3)?novelcl_context.global_size[d]:1;\n}\n"
+                    "size_t get_global_offset(unsigned int d){\nreturn (d < 3)?novelcl_context.global_offset[d]:0;\n}\n"
+                    "size_t get_group_id(unsigned int d){\nreturn get_global_id(d) - get_global_offset(d);\n}\n"
+                    "size_t get_num_groups(unsigned int d){\nreturn get_global_size(d);\n}\n"
+                    "size_t get_local_id(unsigned int d){\nreturn 0;\n}\n"
+                    "size_t get_local_size(unsigned int d){\nreturn 1;\n}\n", kernel->func_name);
+    }
+
+    /*! The preprocessed source has no macros left, so the wrapper uses none.
+     *  It fills in the work-item context the builtins of kernel.h read. */
+    fprintf(cc, "\nstatic void *novelcl_buffer(void *mem, const void *args, size_t offset){\n"
+                "uint64_t devOffset = *(const uint64_t *)((const char *)args + offset);\n"
+                "return (devOffset == ~(uint64_t)0) ? (void *)0 : (char *)mem + devOffset;\n}\n"
+                "__attribute__((visibility(\"default\"))) void kernel_wrapper (const unsigned int begin[3], const unsigned int end[3], "
+                "const unsigned int size[3], const unsigned int offset[3], void* mem, const void *args) {\n"
+                "unsigned int x, y, z;\n");
+    /*! The block is laid out the way get_kernel_args describes it */
+    kernel_arg_layout(kernel, offsets);
+    for(i = 0; i < kernel->arg_count; i++){
+        arg = &(kernel->args[i]);
+        if(arg->type && !arg->isBuffer){
+            fprintf(cc, "_Static_assert(sizeof(%s) == %zu, \"argument %u of %s set with the wrong size\");\n", 
+                    arg->type, arg->size, i, kernel->func_name);
+        }
+        if(arg->isBuffer){
+            fprintf(cc, "%s novelcl_arg%u = (%s)novelcl_buffer(mem, args, %zu);\n", 
+                    arg->type ? arg->type : "void *", i, arg->type ? arg->type : "void *", offsets[i]);
+        }else{
+            fprintf(cc, "%s novelcl_arg%u = *(%s *)((const char *)args + %zu);\n", 
+                    arg->type, i, arg->type, offsets[i]);
+        }
+    }
+    fprintf(cc, "novelcl_context_t *novelcl_ctx = &novelcl_context;\n"
+                "for(z = 0; z < 3; z++){\nnovelcl_ctx->global_size[z] = size[z]; novelcl_ctx->global_offset[z] = offset[z];\n}\n"
+                "for(z = begin[2]; z < end[2]; z++){\nnovelcl_ctx->global_id[2] = offset[2] + z;\n"
+                "for(y = begin[1]; y < end[1]; y++){\nnovelcl_ctx->global_id[1] = offset[1] + y;\n"
+                "for(x = begin[0]; x < end[0]; x++){\nnovelcl_ctx->global_id[0] = offset[0] + x;\n"
+                "%s(", kernel->func_name);
+    for(i = 0; i < kernel->arg_count; i++){
+        fprintf(cc, "%snovelcl_arg%u", i ? ", " : "", i);
+    }
+    fprintf(cc, ");\n}\n}\n}\n}\n");
 
-    if(system(cmd)){
-        // TODO Set error
+    ret = pclose(cc);
+    if(ret != 0){
         DEBUG("clEnqueueNDRangeKernel: kernel compilation failed\n");
         return 0;
     }
     return 1;
 }
 
-int transferKernel(int fd){
+/*!
+* @brief Offer a kernel image to the queue's device session by its hash. The
+*        device takes an image it holds, from any earlier session, as the 
+*        session's kernel. Must be called with the connection mutex held; 
+*        this is the one request that is waited for, a round trip instead 
+*        of an upload.
+* @param command_queue Command queue object
+* @param kernel Kernel whose image is offered
+* @return 1 if the device holds the image, 0 if it has to be uploaded
+*/
+int offerKernel(cl_command_queue command_queue, cl_kernel kernel){
+    char buf[COMM_HEADER_LENGTH + sizeof(KernelOffer_t)];
+    CommPacket_t *offer = (CommPacket_t *)buf;
+    DeviceReply reply;
+    
+    reply.command = NULL;
+    reply.answer = 0;
+    if(!reply_expect(command_queue, &reply, REPLY_OFFER)){
+        return 0;
+    }
+    offer->version = MORACL_PROTOCOL_VERSION;
+    offer->cmdId = OFFER_KERNEL;
+    offer->flags = 0;
+    offer->length = htonl(sizeof(buf));
+    offer->id = htonl(reply.id);
+    offer->payload.offer.hash = htobe64(kernel->imageHash);
+    offer->payload.offer.size = htonl(kernel->imageSize);
+    if(dev_write(command_queue->fd_ctrl, offer, sizeof(buf)) < 0){
+        reply_send_failed(command_queue);
+    }
+    
+    /*! Answered, or failed once the connection is gone */
+    pthread_mutex_lock(&(command_queue->reply_mutex));
+    while(reply.answer == 0){
+        pthread_cond_wait(&(command_queue->reply_cond), &(command_queue->reply_mutex));
+    }
+    pthread_mutex_unlock(&(command_queue->reply_mutex));
+    DEBUG("%s: Kernel %016llx %s.\n", __func__, (unsigned long long)kernel->imageHash, 
+          (reply.answer > 0) ? "held by the device" : "to be uploaded");
+    return reply.answer > 0;
+}
+
+/*!
+* @brief Upload a kernel image to the queue's device session. Must be called 
+*        with the connection mutex held. The upload is not waited for: the 
+*        device loads it before it looks at the launch sent after it. If the
+*        device refuses the image, the receiver forgets it was loaded and 
+*        the launch fails.
+* @param command_queue Command queue object
+* @param kernel Kernel the image is for
+* @param image Kernel image file
+* @return 1 if the image is on its way, 0 on error
+*/
+int transferKernel(cl_command_queue command_queue, cl_kernel kernel, const char *image){
     /* send kernel to device */
-    char buf[1024];
-    CommPacket_t *rsp = (CommPacket_t *)buf;
-    FILE *kfd = fopen("kernel.so", "rb");
-    int kernelLoaded = 0;
-    
-    if (kfd!=NULL){
-        /*! Get kernel size */
-        fseek (kfd , 0 , SEEK_END);
-        int lSize = ftell (kfd);
-        
-        int transferred;
-        int result;
-        int dataSize;
-        int commSize;
-        CommPacket_t *loadKernel = (CommPacket_t *)buf;
-
-        /*! Rewind kernel file) */
-        fseek (kfd , 0 , SEEK_SET);
-
-        transferred = 0;
-        while(transferred < lSize){
-            loadKernel->version = MORACL_PROTOCOL_VERSION;
-            loadKernel->cmdId = LOAD_KERNEL_IMAGE;
-            loadKernel->payload.loadkernel.totalSize = htonl(lSize);
-            loadKernel->payload.loadkernel.offset = htonl(transferred);
-            
-            dataSize = (lSize - transferred > 512)?512:(lSize - transferred);
-            
-            
-            result = fread (loadKernel->payload.loadkernel.data, 1, dataSize, kfd);
-            if(result > 0){
-                DEBUG("%s: Transferring kernel: %d of %d bytes.\n", __func__, transferred, lSize);
-                loadKernel->payload.loadkernel.dataSize = htonl(result);
-                
-                commSize = 4 + 12 + result;
-                loadKernel->length = htons(commSize);
-                
-                dev_write(fd, loadKernel, commSize);
-                dev_read(fd, buf, 4);
-                
-                if(rsp->cmdId == CTRL_ACK){
-                    transferred += result;
-                    if(transferred >= lSize){
-                        DEBUG("%s: Kernel transferred.\n", __func__);
-                        kernelLoaded = 1;
-                    }
-                }else if(rsp->cmdId != CTRL_NAK){
-                    DEBUG("%s: Device error while transferring kernel.\n", __func__);
-                    transferred = 0;
-                    break;
-                }
-            }
+    char buf[COMM_HEADER_LENGTH + sizeof(LoadKernel_t) + MORACL_CHUNK_SIZE];
+    CommPacket_t *loadKernel = (CommPacket_t *)buf;
+    FILE *kfd = fopen(image, "rb");
+    DeviceReply *reply;
+    int lSize;
+    int transferred;
+    int dataSize;
+    int commSize;
+    
+    if(kfd == NULL){
+        DEBUG("%s: Host error while transferring kernel.\n", __func__);
+        return 0;
+    }
+    /*! Get kernel size */
+    fseek(kfd, 0, SEEK_END);
+    lSize = ftell(kfd);
+    fseek(kfd, 0, SEEK_SET);
+
+    /*! Chunks are streamed back to back, the device answers the last one. 
+     *  Nobody waits for the answer, so the receiver frees the reply. */
+    if((reply = (DeviceReply *)malloc(sizeof(DeviceReply))) == NULL){
+        fclose(kfd);
+        return 0;
+    }
+    reply->command = NULL;
+    reply->imageHash = kernel->imageHash;
+    if(!reply_expect(command_queue, reply, REPLY_LOAD)){
+        free(reply);
+        fclose(kfd);
+        return 0;
+    }
+    transferred = 0;
+    do{
+        dataSize = (lSize - transferred > MORACL_CHUNK_SIZE) ? MORACL_CHUNK_SIZE : (lSize - transferred);
+        if(dataSize != (int)fread(loadKernel->payload.loadkernel.data, 1, dataSize, kfd)){
+            DEBUG("%s: Host error while reading kernel.\n", __func__);
+            /*! The device already waits for the rest */
+            reply_send_failed(command_queue);
+            break;
         }
-        
-        fclose (kfd);
-    }else{
-    DEBUG("%s: Host error while transferring kernel.\n", __func__);
-    }
-    return kernelLoaded;
-}
-
-int sendExecuteKernel(int fd){
-    char buf[1024];
-    CommPacket_t *rsp = (CommPacket_t *)buf;
-    CommPacket_t *processCmd = (CommPacket_t *)buf;
-    /*! Prefill some parts of the start command message */
-    processCmd->version = MORACL_PROTOCOL_VERSION;
-    processCmd->cmdId = START_KERNEL;
-    processCmd->length = htons(4);
-    dev_write(fd, processCmd, 4);
-    dev_read(fd, buf, 4);
-    if(rsp->cmdId == CTRL_ACK){
-        DEBUG("%s: Kernel Executing.\n", __func__);
-        return 1;
-    }else{
-        DEBUG("%s: Device error while starting kernel.\n", __func__);
+        DEBUG("%s: Transferring kernel: %d of %d bytes.\n", __func__, transferred, lSize);
+        commSize = COMM_HEADER_LENGTH + sizeof(LoadKernel_t) + dataSize;
+        loadKernel->version = MORACL_PROTOCOL_VERSION;
+        loadKernel->cmdId = LOAD_KERNEL_IMAGE;
+        loadKernel->id = htonl(reply->id);
+        loadKernel->payload.loadkernel.hash = htobe64(kernel->imageHash);
+        loadKernel->flags = htons((transferred + dataSize < lSize) ? MORACL_FLAG_MORE : 0);
+        loadKernel->length = htonl(commSize);
+        loadKernel->payload.loadkernel.totalSize = htonl(lSize);
+        loadKernel->payload.loadkernel.offset = htonl(transferred);
+        loadKernel->payload.loadkernel.dataSize = htonl(dataSize);
+        if(dev_write(command_queue->fd_ctrl, loadKernel, commSize) < 0){
+            reply_send_failed(command_queue);
+            break;
+        }
+        transferred += dataSize;
+    }while(transferred < lSize);
+    fclose(kfd);
+    
+    DEBUG("%s: Kernel sent.\n", __func__);
+    return 1;
+}
+
+/*! 
+* @brief Start the loaded kernel with the launch's work size and arguments, 
+*        in one packet. The memory each buffer argument covers goes along, 
+*        so the device can let transfers to other buffers proceed while the 
+*        kernel runs. Must be called with the connection mutex held. The 
+*        receiver completes the command once the device reports the kernel 
+*        done, mapping the event's START and END times from the device clock
+*        onto the host clock.
+* @param command_queue Command queue object
+* @param command NDRange command, its reply goes in the window
+* @return 1 if the launch is in the window, 0 on error
+*/
+int sendLaunchKernel(cl_command_queue command_queue, QueueCommand *command){
+    ND_Kernel_Cmd_Params *params = command->payload;
+    DeviceReply *reply = &(command->reply);
+    char buf[COMM_HEADER_LENGTH + sizeof(LaunchKernel_t)];
+    CommPacket_t *launch = (CommPacket_t *)buf;
+    MemRange_t ranges[KERNEL_MAX_ARGS];
+    const size_t hdrlen = COMM_HEADER_LENGTH + sizeof(LaunchKernel_t);
+    struct iovec iov[3];
+    uint32_t rangeCount = 0;
+    int i;
+    
+    for(i = 0; i < KERNEL_MAX_ARGS && rangeCount < MORACL_MAX_RANGES; i++){
+        if(params->buffers[i] == NULL){
+            continue;
+        }
+        ranges[rangeCount].offset = htobe64(params->buffers[i]->offset);
+        ranges[rangeCount].length = htobe64(params->buffers[i]->size);
+        ranges[rangeCount].flags = htonl(params->bufferWrites[i] ? MORACL_RANGE_WRITE : 0);
+        rangeCount++;
+    }
+    
+    launch->version = MORACL_PROTOCOL_VERSION;
+    launch->cmdId = LAUNCH_KERNEL;
+    launch->flags = 0;
+    launch->length = htonl(hdrlen + params->argSize + rangeCount * sizeof(MemRange_t));
+    launch->payload.launch.kernel = htobe64(params->kernel->imageHash);
+    launch->payload.launch.globalWorkSize.globalX = htonl(params->globalWorkSize.globalX);
+    launch->payload.launch.globalWorkSize.globalY = htonl(params->globalWorkSize.globalY);
+    launch->payload.launch.globalWorkSize.globalZ = htonl(params->globalWorkSize.globalZ);
+    launch->payload.launch.globalWorkOffset.globalX = htonl(params->globalWorkOffset.globalX);
+    launch->payload.launch.globalWorkOffset.globalY = htonl(params->globalWorkOffset.globalY);
+    launch->payload.launch.globalWorkOffset.globalZ = htonl(params->globalWorkOffset.globalZ);
+    launch->payload.launch.argSize = htonl(params->argSize);
+    launch->payload.launch.rangeCount = htonl(rangeCount);
+    iov[0].iov_base = launch;
+    iov[0].iov_len = hdrlen;
+    iov[1].iov_base = params->args;
+    iov[1].iov_len = params->argSize;
+    iov[2].iov_base = ranges;
+    iov[2].iov_len = rangeCount * sizeof(MemRange_t);
+    reply->command = command;
+    if(!reply_expect(command_queue, reply, REPLY_LAUNCH)){
         return 0;
     }
+    launch->id = htonl(reply->id);
+    reply->sendTime = event_clock();
+    /*! From here on the receiver fails the launch if the connection drops */
+    if(dev_writev(command_queue->fd_ctrl, iov, 3) < 0){
+        reply_send_failed(command_queue);
+    }
+    DEBUG("%s: Kernel queued.\n", __func__);
+    return 1;
 }
 
 
 /*! 
-* @brief Add a command to a command queue
+* @brief Take a zeroed command from the free list of a queue, carving up a 
+*        new slab when it is empty. Must be called with the queue mutex held.
+* @param command_queue Command queue object
+* @return Command, NULL if out of memory
+*/
+static QueueCommand* queue_alloc_command(cl_command_queue command_queue){
+    QueueCommand *cmd;
+    CommandSlab *slab;
+    int i;
+    
+    if(command_queue->freeCommands == NULL){
+        if( (slab = (CommandSlab *)malloc(sizeof(CommandSlab))) == NULL) return NULL;
+        slab->next = command_queue->slabs;
+        command_queue->slabs = slab;
+        for(i = 0; i < QUEUE_SLAB_COMMANDS; i++){
+            slab->commands[i].next = command_queue->freeCommands;
+            command_queue->freeCommands = &(slab->commands[i]);
+        }
+    }
+    cmd = command_queue->freeCommands;
+    command_queue->freeCommands = cmd->next;
+    memset(cmd, 0, sizeof(QueueCommand));
+    
+    return cmd;
+}
+
+/*! 
+* @brief Add a command to a command queue. Must be called with the queue 
+*        mutex held; the command is dispatched once the caller drops it.
 * @param command_queue Command queue object
+* @param type Command type
+* @param access Ranges of device memory the command touches, NULL if unknown
+* @param numAccess Number of ranges
+* @param num_events_in_wait_list Number of events the command waits for
+* @param event_wait_list Events the command waits for, validated by the caller
 * @return Pointer to the newly queued command object. NULL if unsuccessful.
 */
-QueueCommand* queue_add(cl_command_queue command_queue){
+QueueCommand* queue_add(cl_command_queue command_queue, cl_command_type type, 
+                        const MemAccess *access, cl_uint numAccess, 
+                        cl_uint num_events_in_wait_list, const cl_event *event_wait_list){
     QueueCommand *newCmd;
+    QueueCommand *qpos;
+    EventCallback **notify = NULL;
+    cl_int status;
+    cl_uint i;
     
     
     /*! Sanity check if command queue is NULL */
     if(NULL == command_queue) return NULL;
     
+    /*! Hold the caller back while too much is outstanding */
+    queue_wait(command_queue, &(command_queue->done_cond), queue_has_room, 
+               NULL, &(command_queue->host_wait_ns));
     
     /*! Attempt to allocate memory for a new command */
-    newCmd = calloc(sizeof(QueueCommand), 1);
+    newCmd = queue_alloc_command(command_queue);
     if(NULL == newCmd) return NULL;
     
-    /*! Put new element to the back */
-    if(command_queue->queue == NULL){
-        command_queue->queue = newCmd;
-    }else{
-        QueueCommand *tail = command_queue->queue;
-        while(tail->next){
-            tail = tail->next;
-        }
-        tail->next = newCmd;
+    /*! Every command carries an event so that it can be waited on */
+    newCmd->event = event_create(command_queue->context, command_queue, type, CL_QUEUED);
+    if(NULL == newCmd->event){
+        newCmd->next = command_queue->freeCommands;
+        command_queue->freeCommands = newCmd;
+        return NULL;
     }
     
-    /*! Schedule the new event if there is nothing going on*/
-    if(command_queue->currentEvent == NULL){
-        DEBUG("%s: Setting current command.\n", __func__);
-        command_queue->currentEvent = newCmd;
-        DEBUG("%s: Next event -> %p \n", __func__, command_queue->currentEvent);
+    /*! Allocate everything up front so nothing has to be undone once the 
+     *  command is linked in */
+    if(access == NULL){
+        access = &queue_all_memory;
+        numAccess = 1;
     }
-    DEBUG("%s: New event at %p \n", __func__, newCmd);
-    return newCmd;
-}
-
-/*! 
-* @brief Get pointer to the command at the head of a command queue
-* @param command_queue Command queue object
-* @return Pointer to the newly queued command object. NULL if unsuccessful.
-*/
-QueueCommand* queue_head(cl_command_queue command_queue){
-    QueueCommand *head;
-    
-    /*! Sanity check if command queue is NULL */
-    if(NULL == command_queue) return NULL;
+    newCmd->access = &(newCmd->range);
+    if(numAccess > 1 && 
+       (newCmd->access = (MemAccess *)malloc(numAccess * sizeof(MemAccess))) == NULL){
+        clReleaseEvent(newCmd->event);
+        newCmd->next = command_queue->freeCommands;
+        command_queue->freeCommands = newCmd;
+        return NULL;
+    }
+    memcpy(newCmd->access, access, numAccess * sizeof(MemAccess));
+    newCmd->numAccess = numAccess;
+    if(num_events_in_wait_list){
+        newCmd->waitEvents = malloc(num_events_in_wait_list * sizeof(cl_event));
+        notify = calloc(num_events_in_wait_list, sizeof(EventCallback *));
+        for(i = 0; notify && i < num_events_in_wait_list; i++){
+            if( (notify[i] = malloc(sizeof(EventCallback))) == NULL) break;
+        }
+        if(NULL == newCmd->waitEvents || NULL == notify || i < num_events_in_wait_list){
+            for(i = 0; notify && i < num_events_in_wait_list; i++){
+                free(notify[i]);
+            }
+            free(notify);
+            free(newCmd->waitEvents);
+            if(newCmd->access != &(newCmd->range)){
+                free(newCmd->access);
+            }
+            clReleaseEvent(newCmd->event);
+            newCmd->next = command_queue->freeCommands;
+            command_queue->freeCommands = newCmd;
+            return NULL;
+        }
+    }
+    newCmd->eventStatus = CL_QUEUED;
+    newCmd->commandType = type;
+    newCmd->depStatus = CL_SUCCESS;
     
-    pthread_mutex_lock(&(command_queue->queue_mutex));
-    head = command_queue->queue;
+    /*! Depend on every unfinished command it conflicts with. An in-order 
+     *  queue only needs to wait for the one before it, unless the device 
+     *  does not order the new command: commands let go once the one before
+     *  them is sent can finish ahead of it, so it waits for all of them. 
+     *  Back to the previous such command is enough, that one waited for 
+     *  the rest. */
+    if(command_queue->props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE){
+        for(qpos = command_queue->queue; qpos; qpos = qpos->next){
+            if(queue_depends(command_queue, qpos, newCmd)){
+                newCmd->pending++;
+            }
+        }
+    }else if(command_queue->queueTail){
+        if(!(command_queue->queueTail->sent && queue_device_ordered(command_queue->queueTail, newCmd))){
+            newCmd->pending++;
+        }
+        if(!queue_device_command(newCmd)){
+            for(qpos = command_queue->queueTail; qpos; qpos = qpos->prev){
+                if(qpos != command_queue->queueTail){
+                    newCmd->pending++;
+                }
+                qpos->gate = newCmd;
+                if(!queue_device_command(qpos)) break;
+            }
+        }
+    }
     
-    /*! Check if the command queue has any elements */
-    if(NULL == head) return NULL;
+    /*! Put new element to the back */
+    newCmd->prev = command_queue->queueTail;
+    if(command_queue->queueTail){
+        command_queue->queueTail->next = newCmd;
+    }else{
+        command_queue->queue = newCmd;
+    }
+    command_queue->queueTail = newCmd;
     
-    /*! Get to the head of the queue */
-    while(head){
-        if(head->next == NULL){
-            return head;
+    /*! Wait list events release the command through a callback */
+    for(i = 0; i < num_events_in_wait_list; i++){
+        clRetainEvent(event_wait_list[i]);
+        newCmd->waitEvents[i] = event_wait_list[i];
+        notify[i]->type = CL_COMPLETE;
+        notify[i]->pfn_notify = queue_event_done;
+        notify[i]->user_data = newCmd;
+        status = event_notify(event_wait_list[i], notify[i]);
+        if(status > CL_COMPLETE){
+            newCmd->pending++;
         }else{
-            head = head->next;
+            free(notify[i]);
+            if(status < 0){
+                newCmd->depStatus = CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+            }
         }
     }
-    pthread_mutex_unlock(&(command_queue->queue_mutex));
-    return NULL;
+    newCmd->numWaitEvents = num_events_in_wait_list;
+    free(notify);
+    
+    command_queue->outstanding++;
+    if(newCmd->pending == 0){
+        command_queue->numReady++;
+        /*! Wake a queue thread; it runs once the caller drops the lock */
+        pthread_cond_signal(&(command_queue->queue_cond));
+    }
+    DEBUG("%s: New event at %p, waiting for %u\n", __func__, newCmd, newCmd->pending);
+    return newCmd;
 }
 
 
 /*! 
-* @brief Remove a command from a queue
+* @brief Remove a command from a queue and put it back on the free list. Must
+*        be called with the queue mutex held.
 * @param command_queue Command queue object
 * @param cmd Pointer to command
-* @return Pointer to the newly queued command object. NULL if unsuccessful.
 */
 void queue_remove(cl_command_queue command_queue, QueueCommand *cmd){
-    QueueCommand *tmp;
-    QueueCommand **prev;
+    cl_uint i;
     
     /*! Sanity check if command queue is NULL */
     if(NULL == command_queue) return;
     
-    prev = &(command_queue->queue);
+    if(cmd->prev){
+        cmd->prev->next = cmd->next;
+    }else{
+        command_queue->queue = cmd->next;
+    }
+    if(cmd->next){
+        cmd->next->prev = cmd->prev;
+    }else{
+        command_queue->queueTail = cmd->prev;
+    }
     
-    while(*prev){
-        if(cmd == *prev){
-            *prev = (*prev)->next;
-            free(cmd->payload);
-            free(cmd);
-            return;
-        }
-        //Next element
-        prev = &((*prev)->next);
+    for(i = 0; i < cmd->numWaitEvents; i++){
+        clReleaseEvent(cmd->waitEvents[i]);
     }
-
-    return;
+    free(cmd->waitEvents);
+    clReleaseEvent(cmd->event);
+    if(cmd->commandType == CL_COMMAND_NDRANGE_KERNEL){
+        kernel_params_release(cmd->payload);
+    }
+    if(cmd->buffer){
+        clReleaseMemObject(cmd->buffer);
+    }
+    if(cmd->access != &(cmd->range)){
+        free(cmd->access);
+    }
+    free(cmd->payload);
+    
+    cmd->next = command_queue->freeCommands;
+    command_queue->freeCommands = cmd;
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
@@ -6,12 +6,6 @@
 #define CL_DEFS_H
 
 
-/* python 2.x */
-#define PYTHON "python2.7"
-
-
-
-
 /* Platform */
 extern struct _cl_platform_id platformID_0;
 #define PF_ID &platformID_0
@@ -30,18 +24,50 @@ extern struct _cl_platform_id platformID_0;
 
 #define PREFERRED_VECTOR_WIDTH_CHAR 256 //some number.
 
-#define MAX_MEM_ALLOC_SIZE 4*1024 //Some number.
+/* Buffer alignment in bits, as reported by CL_DEVICE_MEM_BASE_ADDR_ALIGN */
+#define MEM_BASE_ADDR_ALIGN (sizeof(void *) << 3)
+
+/* Kernel arguments, the largest by-value argument being a double16 */
+#define KERNEL_MAX_ARGS 64
+#define KERNEL_ARG_MAX_SIZE 128
 
 #define MAX_WORK_ITEM_SIZES 256 //Some number.
 #define MAX_WORK_GROUP_SIZE (MAX_WORK_ITEM_SIZES * MAX_WORK_ITEM_SIZES * MAX_WORK_ITEM_SIZES)
 
 #include <pthread.h>
+#include <sys/types.h>
 #include "dev_interface.h"
 #include <time.h>
 
 
-#define EVENT_EXPIRY_TIME_S 60
+/* Environment variable holding the spin-then-block budget in microseconds */
+#define QUEUE_SPIN_ENV "NOVELCL_QUEUE_SPIN_US"
+/* Environment variable limiting the commands outstanding on a queue, 0 for no limit */
+#define QUEUE_MAX_COMMANDS_ENV "NOVELCL_QUEUE_MAX_COMMANDS"
+#define QUEUE_MAX_COMMANDS 1024
+/* Commands allocated at a time when a queue's free list runs dry */
+#define QUEUE_SLAB_COMMANDS 64
 #define CL_CUSTOM_COMMAND_BARRIER 0x1300
+/* Build cache location and size limit in MB, a limit of 0 disables the cache */
+#define BUILD_CACHE_DIR_ENV "NOVELCL_CACHE_DIR"
+#define BUILD_CACHE_MAX_MB_ENV "NOVELCL_CACHE_MAX_MB"
+#define BUILD_CACHE_MAX_MB 256
+/* Version of the kernel wrapper compileKernel generates, part of the cache 
+ * key of every kernel image; bump it whenever the wrapper's text changes */
+#define KERNEL_WRAPPER_ABI "2"
+/* Name of the private directory each program is built in, see mkdtemp */
+#define BUILD_DIR_TEMPLATE "novelcl-XXXXXX"
+/* Dispatch threads of an out-of-order command queue */
+#define QUEUE_OOO_WORKERS 4
+/* Requests a queue can have on the wire, unanswered; running kernels count */
+#define QUEUE_WINDOW 256
+/* Returned by queue_dispatchCommand for a command on the wire; the receiver
+ * thread completes it once the device answers */
+#define QUEUE_SENT 1
+/* Kernels a queue counts on its device session holding. Half what the 
+ * session keeps, so that an answer the queue has not seen yet cannot make 
+ * it count on one the session has let go. */
+#define QUEUE_KERNELS (MORACL_SESSION_KERNELS / 2)
 
 
 /** Platform ID format */
@@ -62,10 +88,9 @@ struct _cl_device_id{
     char *vendor;
     char *version;
     char *name; 
-    cl_bool connected;
     cl_bool hasKernel;
     cl_uint preferred_vector_width_char;
-    int fd_ctrl;
+    cl_ulong global_mem_size;           /*! Reported by the device on connect */
 };
 
 
@@ -73,51 +98,157 @@ struct _cl_device_id{
 struct _cl_context{
     cl_uint refcount;
     cl_uint num_devices;
-    const cl_device_id *devices;
+    cl_device_id *devices;
     cl_context_properties props[3];
-    unsigned int mem_alloc_offset;
+    uint64_t spaceKey;                  /*! Names the context's address space on the device */
+    int fd_space;                       /*! Holds the address space while the context lives */
+    pthread_mutex_t mem_mutex;          /*! Guards the allocator of the address space */
+    struct MemBlock_t *mem_free_list;   /*! Free ranges of the address space, by address */
+    cl_memory_statistics_novel mem_stats;
+    struct _cl_context *mem_next;       /*! Next live context, for the device's statistics */
 };
 
+/** Range of device memory accessed by a command */
+typedef struct MemAccess_t{
+    size_t start;
+    size_t end;
+    cl_bool write;
+} MemAccess;
+
+/* What a request expects back from the device, see DeviceReply */
+#define REPLY_ACK 0                     /* ACK or NAK */
+#define REPLY_READ 1                    /* MEM_READ_RSP chunks */
+#define REPLY_LAUNCH 2                  /* ACK, then KERNEL_DONE once the kernel has run */
+#define REPLY_LOAD 3                    /* ACK or NAK for a kernel image, nobody waits for it */
+#define REPLY_OFFER 4                   /* ACK if the device holds an image, NAK if not */
+
+/** A request sent to the device, waiting for its answer. The device 
+ *  answers under the request's id, so answers are matched whatever order 
+ *  they come in. The receiver thread completes the request's command. */
+typedef struct DeviceReply_t{
+    uint32_t id;                        /*! Request id, slot id % QUEUE_WINDOW of the queue */
+    int kind;                           /*! REPLY_ACK, REPLY_READ, REPLY_LAUNCH, REPLY_LOAD or REPLY_OFFER */
+    struct QueueCommand_t *command;     /*! Completed by the answer, NULL for REPLY_LOAD */
+    void *data;                         /*! REPLY_READ: destination */
+    uint64_t offset;                    /*! REPLY_READ: device address of data */
+    uint64_t length;                    /*! REPLY_READ: bytes requested */
+    cl_ulong sendTime;                  /*! REPLY_LAUNCH: host clock when the launch was sent */
+    uint64_t imageHash;                 /*! REPLY_LOAD: of the image uploaded */
+    int answer;                         /*! REPLY_OFFER: 0 until answered, 1 if held, -1 if not */
+} DeviceReply;
+
 /** Internal Implementation of Command queue Linked list */
 typedef struct QueueCommand_t{
-    struct QueueCommand_t *next;        /*! Pointer to the next command */
+    struct QueueCommand_t *next;        /*! Pointer to the next command, or the next free one */
+    struct QueueCommand_t *prev;        /*! Pointer to the previous command */
     cl_int eventStatus;                 /*! Status of the event */
     cl_command_type commandType;        /*! Command Type */
+    cl_event event;                     /*! Event tracking this command, owned by the command */
+    cl_uint numWaitEvents;              /*! Number of events in the wait list */
+    cl_event *waitEvents;               /*! Retained copy of the wait list */
     void *payload;                      /*! Pointer to memory containing payload for the command.*/
     void *ret;                          /*! Return pointer */
-    time_t completionTime;              /*! The time the command was completed */
+    cl_mem buffer;                      /*! Buffer a transfer uses, held until the command is removed */
+    cl_uint pending;                    /*! Earlier conflicting commands and wait list events not yet complete */
+    cl_int depStatus;                   /*! CL_SUCCESS, or the error to complete with if a wait list event failed */
+    MemAccess *access;                  /*! Device memory touched by the command, numAccess ranges */
+    cl_uint numAccess;
+    MemAccess range;                    /*! Where access points for a command touching one range */
+    struct QueueCommand_t *gate;        /*! In-order queue: later command the device does not order, waiting for this one */
+    int sent;                           /*! On the wire, the device orders what follows */
+    int replied;                        /*! Answered before the dispatch thread saw it sent */
+    cl_int replyStatus;                 /*! Status the answer completes the command with */
+    DeviceReply reply;                  /*! Answer expected from the device */
 } QueueCommand;
 
+/** Block of commands carved up into a queue's free list */
+typedef struct CommandSlab_t{
+    struct CommandSlab_t *next;
+    QueueCommand commands[QUEUE_SLAB_COMMANDS];
+} CommandSlab;
+
 /** Implementation of cl_command_queue */
 struct _cl_command_queue{
     cl_uint refcount;
     cl_context context;
     cl_device_id device;
     cl_command_queue_properties props;
-    pthread_t queue_thread;
+    int fd_ctrl;                        /*! Connection to the queue's session on the device */
+    uint64_t kernels[QUEUE_KERNELS];    /*! Image hashes the session holds, used last first; under reply_mutex */
+    int kernelCount;
+    pthread_t *workers;                 /*! Dispatch threads, one unless out-of-order execution is enabled */
+    cl_uint numWorkers;
     pthread_mutex_t queue_mutex;
-    QueueCommand *queue;
-    QueueCommand *currentEvent;
+    pthread_mutex_t conn_mutex;         /*! Serialises requests sent on the device connection */
+    pthread_t receiver;                 /*! Reads every answer from the device, see queue_receiver */
+    pthread_mutex_t reply_mutex;
+    pthread_cond_t reply_cond;          /*! Broadcast when a request leaves the window */
+    DeviceReply *inflight[QUEUE_WINDOW];  /*! Requests not answered yet, by id */
+    uint32_t nextId;                    /*! Id of the next request */
+    int connLost;                       /*! The receiver has stopped, requests fail at once */
+    pthread_cond_t queue_cond;          /*! Signalled when a command is queued or the queue is released */
+    pthread_cond_t done_cond;           /*! Signalled when a command completes */
+    unsigned long spin_ns;              /*! Maximum time to spin before blocking, 0 to block immediately */
+    unsigned long worker_wait_ns;       /*! Running estimate of how long the worker waits for work */
+    unsigned long host_wait_ns;         /*! Running estimate of how long host calls wait for completion */
+    QueueCommand *queue;                /*! Commands not yet complete, in enqueue order */
+    QueueCommand *queueTail;
+    QueueCommand *freeCommands;         /*! Recycled commands */
+    CommandSlab *slabs;                 /*! Memory behind all commands of the queue */
+    cl_uint numReady;                   /*! Commands whose dependencies are all met, waiting for a thread */
+    cl_uint outstanding;                /*! Commands not yet complete */
+    cl_uint maxOutstanding;             /*! Enqueueing blocks at this many outstanding commands, 0 for never */
 };
 
 
 /** Implementation of cl_mem */
 struct _cl_mem{
     cl_uint refcount;
+    cl_context context;
     size_t offset;
     size_t size;
 };
 
+/** Everything a cached build depends on, see build_cache.c */
+typedef struct CacheKey_t{
+    char *data;                         /*! NULL once an append has failed */
+    size_t len;
+    size_t cap;
+} CacheKey;
+
+/** Free range of device memory */
+typedef struct MemBlock_t{
+    size_t offset;
+    size_t size;
+    struct MemBlock_t *next;            /*! Next free range, by address */
+} MemBlock;
+
+
+/** Argument of a kernel */
+typedef struct KernelArg_t{
+    char *type;                         /*! Declared type, NULL when the signature is unknown */
+    cl_bool isBuffer;                   /*! Pointer argument, bound to a cl_mem */
+    cl_bool readOnly;                   /*! Buffer the kernel only reads through */
+    cl_bool set;                        /*! Given a value by clSetKernelArg */
+    size_t typeSize;                    /*! Size the declared type needs, 0 if not known */
+    size_t size;
+    cl_mem mem;                         /*! Bound buffer, retained, NULL for a NULL pointer */
+    unsigned char value[KERNEL_ARG_MAX_SIZE];   /*! By-value argument */
+} KernelArg;
 
 /** Implementation of cl_kernel */
 struct _cl_kernel{
     cl_uint refcount;
     char* lib_name;
     char* func_name;
-    size_t args[64];
-    void* argv[64];
-    unsigned int arg_count;
-    cl_bool isNew;
+    KernelArg args[KERNEL_MAX_ARGS];
+    cl_uint arg_count;                  /*! Declared arguments, or the highest one set without a signature */
+    cl_bool hasSignature;               /*! Argument types were read from the program source */
+    cl_uint id;                         /*! Unique per kernel object, identifies its built image */
+    cl_program program;                 /*! Retained, its build directory holds the image */
+    char *buildDir;                     /*! Directory holding the built kernel.so, NULL until built */
+    uint64_t imageHash;                 /*! Of kernel.so, offered to the device before uploading it */
+    cl_uint imageSize;
 };
 
 struct _cl_source{
@@ -137,30 +268,88 @@ struct _cl_program{
     size_t binarySize;
     cl_bool createdWithBinary;
     cl_bool hasBinary;
+    char *buildDir;                     /*! Private directory the program and its kernels are built in */
+    pthread_mutex_t build_mutex;        /*! Serialises builds of the program's kernels */
 };
 
 
 
+/** Callback registered through clSetEventCallback */
+typedef struct EventCallback_t{
+    struct EventCallback_t *next;
+    cl_int type;
+    void (CL_CALLBACK *pfn_notify)(cl_event event, cl_int status, void *user_data);
+    void *user_data;
+} EventCallback;
+
 /** Implementation of cl_event */
 struct _cl_event{
     cl_uint refcount;
+    cl_context context;
+    cl_command_queue queue;             /*! Queue of the command, NULL for user events. Not retained,
+                                            the event may outlive it: only handed back as a handle */
+    cl_bool profiling;                  /*! The queue had profiling enabled */
+    cl_command_type commandType;
+    cl_int status;                      /*! CL_QUEUED -> CL_SUBMITTED -> CL_RUNNING -> CL_COMPLETE, or an error */
+    pthread_mutex_t event_mutex;
+    pthread_cond_t event_cond;          /*! Broadcast on every status change */
+    EventCallback *callbacks;
+    cl_ulong profile[4];                /*! QUEUED, SUBMIT, START and END times in ns, host clock */
 };
 
+/* Index into the profile array of an event */
+#define PROFILE_INDEX(param) ((param) - CL_PROFILING_COMMAND_QUEUED)
+
 typedef struct ND_Kernel_Cmd_Params_t {
     GlobalWorkSize_t globalWorkSize;
-    cl_kernel kernel;
+    GlobalWorkSize_t globalWorkOffset;  /*! Global ID of the first work item */
+    cl_kernel kernel;                   /*! Retained until the command is removed */
+    cl_uint numBuffers;
+    cl_mem buffers[KERNEL_MAX_ARGS];    /*! Buffers bound when enqueued, retained */
+    cl_bool bufferWrites[KERNEL_MAX_ARGS];  /*! The kernel may write to the buffer */
+    size_t argSize;
+    unsigned char args[];               /*! Argument block sent with the launch */
 } ND_Kernel_Cmd_Params;
 
-void queue_dispatchCommand(cl_command_queue command_queue, QueueCommand *command);
-void dispatchNDRangeKernel(cl_device_id device, QueueCommand *command);
-int setGlobalWorkSize(int fd, int globalX, int globalY, int globalZ);
-int setKernelArguments(cl_kernel kernel);
-int compileKernel(char * func_name, int globalX, int globalY, int globalZ);
-int transferKernel(int fd);
-int sendExecuteKernel(int fd);
+cl_int queue_dispatchCommand(cl_command_queue command_queue, QueueCommand *command);
+cl_int dispatchNDRangeKernel(cl_command_queue command_queue, QueueCommand *command);
+int compileKernel(cl_kernel kernel, const char *dir);
+int offerKernel(cl_command_queue command_queue, cl_kernel kernel);
+int transferKernel(cl_command_queue command_queue, cl_kernel kernel, const char *image);
+int sendLaunchKernel(cl_command_queue command_queue, QueueCommand *command);
+void *queue_receiver(void *arg);
 
 char* get_kernel_args(cl_kernel kernel);
-QueueCommand* queue_add(cl_command_queue command_queue);
-QueueCommand* queue_head(cl_command_queue command_queue);
+size_t kernel_arg_layout(cl_kernel kernel, size_t *offsets);
+void kernel_params_release(ND_Kernel_Cmd_Params *params);
+QueueCommand* queue_add(cl_command_queue command_queue, cl_command_type type, 
+                        const MemAccess *access, cl_uint numAccess, 
+                        cl_uint num_events_in_wait_list, const cl_event *event_wait_list);
+void queue_remove(cl_command_queue command_queue, QueueCommand *cmd);
+cl_int queue_wait_event(cl_command_queue command_queue, cl_event event);
+
+cl_ulong event_clock(void);
+cl_event event_create(cl_context context, cl_command_queue queue, cl_command_type type, cl_int status);
+void event_set_status(cl_event event, cl_int status);
+cl_int event_notify(cl_event event, EventCallback *cb);
+void event_set_device_times(cl_event event, cl_ulong start, cl_ulong end);
+cl_int event_wait(cl_event event);
+cl_int event_check_wait_list(cl_uint num_events, const cl_event *event_list);
+
+int cache_key_init(CacheKey *key, const char *kind);
+int cache_key_add(CacheKey *key, const char *str);
+int cache_key_add_file(CacheKey *key, const char *path);
+void cache_key_free(CacheKey *key);
+char *build_dir_create(void);
+off_t build_dir_remove(const char *path);
+int cache_lookup(const CacheKey *key, const char *dir, const char **files);
+void cache_store(const CacheKey *key, const char *dir, const char **files);
+void cache_statistics(cl_build_cache_statistics_novel *stats);
+
+size_t mem_align(size_t size);
+cl_int mem_context_init(cl_context context);
+void mem_context_release(cl_context context);
+void mem_statistics(cl_context context, cl_memory_statistics_novel *stats);
+void mem_device_statistics(cl_memory_statistics_novel *stats);
 
 #endif /* CL_DEFS_H */
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "cl_defs.h"
+#include "dev_interface.h"
 
 static char *clDeviceExtensions = "";
 
@@ -20,6 +21,8 @@ cl_device_id *devices,
 cl_uint *num_devices)
 {
     cl_device_id fpga;
+    uint64_t memSize;
+    int fd;
 
     DEBUG("%s called\n", __func__);
     
@@ -43,13 +46,21 @@ cl_uint *num_devices)
 
     DEBUG("%s: Warning: Not fully implemented\n", __func__);
     if(devices){
+        /*! The device reports its memory size, so it has to be running */
+        if((fd = dev_connect(CONN_CTRL)) == -1)
+            return CL_DEVICE_NOT_FOUND;
+        if(dev_hello(fd, 0, &memSize) != 0){
+            dev_disconnect(fd);
+            return CL_DEVICE_NOT_FOUND;
+        }
+        dev_disconnect(fd);
         if((fpga = (cl_device_id)malloc(sizeof(struct _cl_device_id))) == NULL)
             return CL_OUT_OF_HOST_MEMORY;
+        fpga->global_mem_size = memSize;
         fpga->type = DV_TYPE;
         fpga->vendor = strdup(DV_VENDOR);
         fpga->name = strdup(DV_NAME);
         fpga->version = strdup(DV_VERSION);
-        fpga->connected = CL_FALSE;
         fpga->preferred_vector_width_char = PREFERRED_VECTOR_WIDTH_CHAR;
         devices[0] = fpga;
     }
@@ -104,23 +115,43 @@ size_t *param_value_size_ret)
             
         case CL_DEVICE_MEM_BASE_ADDR_ALIGN:
             DEBUG("%s: Device Base Addr Align \n", __func__);
-            *(cl_uint *)param_value = sizeof(void *) << 3;
+            *(cl_uint *)param_value = MEM_BASE_ADDR_ALIGN;
             if(param_value_size_ret) *param_value_size_ret = sizeof(cl_uint);
             return CL_SUCCESS;
             break;
         case CL_DEVICE_MAX_MEM_ALLOC_SIZE:
             DEBUG("%s: Device Max Mem Alloc size \n", __func__);
-            *(cl_ulong *)param_value = MAX_MEM_ALLOC_SIZE >> 2;
+            *(cl_ulong *)param_value = device->global_mem_size;
             if(param_value_size_ret) *param_value_size_ret = sizeof(cl_ulong);
             return CL_SUCCESS;
             break;
         case CL_DEVICE_GLOBAL_MEM_SIZE:
             DEBUG("%s: Device Global mem size \n", __func__);
-            *(cl_ulong *)param_value = MAX_MEM_ALLOC_SIZE;
+            *(cl_ulong *)param_value = device->global_mem_size;
             if(param_value_size_ret) *param_value_size_ret = sizeof(cl_ulong);
             return CL_SUCCESS;
             break;
             
+        case CL_DEVICE_MEMORY_STATISTICS_NOVEL:
+            DEBUG("%s: Device memory statistics \n", __func__);
+            if(param_value_size_ret) *param_value_size_ret = sizeof(cl_memory_statistics_novel);
+            if(param_value){
+                if(param_value_size < sizeof(cl_memory_statistics_novel)) return CL_INVALID_VALUE;
+                mem_device_statistics((cl_memory_statistics_novel *)param_value);
+            }
+            return CL_SUCCESS;
+            break;
+            
+        case CL_DEVICE_BUILD_CACHE_STATISTICS_NOVEL:
+            DEBUG("%s: Build cache statistics \n", __func__);
+            if(param_value_size_ret) *param_value_size_ret = sizeof(cl_build_cache_statistics_novel);
+            if(param_value){
+                if(param_value_size < sizeof(cl_build_cache_statistics_novel)) return CL_INVALID_VALUE;
+                cache_statistics((cl_build_cache_statistics_novel *)param_value);
+            }
+            return CL_SUCCESS;
+            break;
+            
         case CL_DEVICE_MAX_WORK_ITEM_SIZES:
             DEBUG("%s: Device Max work item sizes \n", __func__);
             ((size_t *)param_value)[0] = MAX_WORK_ITEM_SIZES;
@@ -164,7 +195,21 @@ size_t *param_value_size_ret)
             *(cl_uint *)param_value = device->preferred_vector_width_char/sizeof(cl_int);
             return CL_SUCCESS;
             break;
-            
+
+        case CL_DEVICE_QUEUE_PROPERTIES:
+            DEBUG("%s: Device Queue Properties\n", __func__);
+            if(param_value_size_ret) *param_value_size_ret = sizeof(cl_command_queue_properties);
+            *(cl_command_queue_properties *)param_value = CL_QUEUE_PROFILING_ENABLE | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+            return CL_SUCCESS;
+            break;
+
+        case CL_DEVICE_PROFILING_TIMER_RESOLUTION:
+            DEBUG("%s: Device Profiling Timer Resolution\n", __func__);
+            if(param_value_size_ret) *param_value_size_ret = sizeof(size_t);
+            *(size_t *)param_value = 1;
+            return CL_SUCCESS;
+            break;
+
         default:
             return CL_INVALID_VALUE;
     }
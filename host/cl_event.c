@@ -11,6 +11,181 @@
 
 
 
+/*!
+* @brief Host clock used for event timestamps
+* @return Monotonic time in nanoseconds
+*/
+cl_ulong event_clock(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (cl_ulong)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+
+/*!
+* @brief Create an event
+* @param context Context the event belongs to
+* @param queue Queue of the command tracked by the event, NULL for user events
+* @param type Command type reported through clGetEventInfo
+* @param status Initial execution status
+* @return New event with a reference count of one. NULL if out of memory.
+*/
+cl_event event_create(cl_context context, cl_command_queue queue, cl_command_type type, cl_int status){
+    cl_event event;
+
+    if( (event = (cl_event)malloc(sizeof(struct _cl_event))) == NULL){
+        return NULL;
+    }
+    event->refcount = 1; /* implicit retain */
+    event->context = context;
+    event->queue = queue;
+    event->profiling = queue != NULL && (queue->props & CL_QUEUE_PROFILING_ENABLE);
+    event->commandType = type;
+    event->status = status;
+    event->callbacks = NULL;
+    memset(event->profile, 0, sizeof(event->profile));
+    event->profile[PROFILE_INDEX(CL_PROFILING_COMMAND_QUEUED)] = event_clock();
+    pthread_mutex_init(&(event->event_mutex), NULL);
+    pthread_cond_init(&(event->event_cond), NULL);
+
+    return event;
+}
+
+
+
+/*!
+* @brief Move an event to a new execution status, waking waiters and calling
+*        any callbacks registered for the status reached.
+* @param event Event object
+* @param status CL_SUBMITTED, CL_RUNNING, CL_COMPLETE or a negative error code
+*/
+void event_set_status(cl_event event, cl_int status){
+    EventCallback *fired = NULL;
+    EventCallback **prev;
+    EventCallback *cb;
+    cl_ulong *stamp;
+    cl_ulong now = event_clock();
+
+    pthread_mutex_lock(&(event->event_mutex));
+    event->status = status;
+
+    /*! Times already supplied by the device are kept */
+    if(status == CL_SUBMITTED){
+        stamp = &(event->profile[PROFILE_INDEX(CL_PROFILING_COMMAND_SUBMIT)]);
+    }else if(status == CL_RUNNING){
+        stamp = &(event->profile[PROFILE_INDEX(CL_PROFILING_COMMAND_START)]);
+    }else{
+        stamp = &(event->profile[PROFILE_INDEX(CL_PROFILING_COMMAND_END)]);
+    }
+    if(*stamp == 0){
+        *stamp = now;
+    }
+
+    /*! Statuses count down towards CL_COMPLETE, errors also terminate */
+    prev = &(event->callbacks);
+    while(*prev){
+        cb = *prev;
+        if(status <= cb->type){
+            *prev = cb->next;
+            cb->next = fired;
+            fired = cb;
+        }else{
+            prev = &(cb->next);
+        }
+    }
+    pthread_cond_broadcast(&(event->event_cond));
+    pthread_mutex_unlock(&(event->event_mutex));
+
+    /*! Callbacks may call back into the runtime, so run them unlocked */
+    while(fired){
+        cb = fired;
+        fired = cb->next;
+        cb->pfn_notify(event, status, cb->user_data);
+        free(cb);
+    }
+}
+
+
+
+/*!
+* @brief Record the execution window reported by the device. Must be called 
+*        before the event completes.
+* @param event Event object
+* @param start Start of execution, host clock in ns
+* @param end End of execution, host clock in ns
+*/
+void event_set_device_times(cl_event event, cl_ulong start, cl_ulong end){
+    pthread_mutex_lock(&(event->event_mutex));
+    event->profile[PROFILE_INDEX(CL_PROFILING_COMMAND_START)] = start;
+    event->profile[PROFILE_INDEX(CL_PROFILING_COMMAND_END)] = end;
+    pthread_mutex_unlock(&(event->event_mutex));
+}
+
+
+
+/*!
+* @brief Register a callback unless the event has already reached the status 
+*        it is registered for.
+* @param event Event object
+* @param cb Filled in callback. Ownership passes to the event if registered.
+* @return Status of the event. If it is not above cb->type the callback was 
+*         not registered or called and still belongs to the caller.
+*/
+cl_int event_notify(cl_event event, EventCallback *cb){
+    cl_int status;
+
+    pthread_mutex_lock(&(event->event_mutex));
+    status = event->status;
+    if(status > cb->type){
+        cb->next = event->callbacks;
+        event->callbacks = cb;
+    }
+    pthread_mutex_unlock(&(event->event_mutex));
+
+    return status;
+}
+
+
+
+/*!
+* @brief Block until an event has completed
+* @param event Event object
+* @return CL_COMPLETE or the negative error status of the event
+*/
+cl_int event_wait(cl_event event){
+    cl_int status;
+
+    pthread_mutex_lock(&(event->event_mutex));
+    while(event->status > CL_COMPLETE){
+        pthread_cond_wait(&(event->event_cond), &(event->event_mutex));
+    }
+    status = event->status;
+    pthread_mutex_unlock(&(event->event_mutex));
+
+    return status;
+}
+
+
+
+/*!
+* @brief Validate an event wait list passed to an API call
+* @return CL_SUCCESS or CL_INVALID_EVENT_WAIT_LIST
+*/
+cl_int event_check_wait_list(cl_uint num_events, const cl_event *event_list){
+    cl_uint i;
+
+    if((num_events == 0) != (event_list == NULL))
+        return CL_INVALID_EVENT_WAIT_LIST;
+
+    for(i = 0; i < num_events; i++){
+        if(event_list[i] == NULL)
+            return CL_INVALID_EVENT_WAIT_LIST;
+    }
+    return CL_SUCCESS;
+}
+
+
 
 cl_event clCreateUserEvent(
 cl_context context,
@@ -19,11 +194,14 @@ cl_int *errcode_ret)
     cl_event event;
 
     DEBUG("clCreateUserEvent called\n");
-    if( (event = (cl_event)malloc(sizeof(struct _cl_event))) == NULL){
+    if(context == NULL){
+        if(errcode_ret) *errcode_ret = CL_INVALID_CONTEXT;
+        return NULL;
+    }
+    if( (event = event_create(context, NULL, CL_COMMAND_USER, CL_SUBMITTED)) == NULL){
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
         return NULL;
     }
-    event->refcount = 1; /* implicit retain */
     if(errcode_ret) *errcode_ret = CL_SUCCESS;
 
     return event;
@@ -32,6 +210,33 @@ cl_int *errcode_ret)
 
 
 
+cl_int clSetUserEventStatus(
+cl_event event,
+cl_int execution_status)
+{
+    cl_int status;
+
+    DEBUG("clSetUserEventStatus called (%d)\n", execution_status);
+    if(event == NULL || event->commandType != CL_COMMAND_USER)
+        return CL_INVALID_EVENT;
+
+    if(execution_status > CL_COMPLETE)
+        return CL_INVALID_VALUE;
+
+    /*! The status of a user event can only be set once */
+    pthread_mutex_lock(&(event->event_mutex));
+    status = event->status;
+    pthread_mutex_unlock(&(event->event_mutex));
+    if(status != CL_SUBMITTED)
+        return CL_INVALID_OPERATION;
+
+    event_set_status(event, execution_status);
+
+    return CL_SUCCESS;
+}
+
+
+
 cl_int clRetainEvent(
 cl_event event)
 {
@@ -39,7 +244,7 @@ cl_event event)
     if(event == NULL)
         return CL_INVALID_EVENT;
 
-    event->refcount += 1;
+    __atomic_add_fetch(&(event->refcount), 1, __ATOMIC_ACQ_REL);
 
     return CL_SUCCESS;
 
@@ -50,14 +255,23 @@ cl_event event)
 cl_int clReleaseEvent(
 cl_event event)
 {
+    EventCallback *cb;
+
     DEBUG("clReleaseEvent called\n");
     if(event == NULL)
         return CL_INVALID_EVENT;
 
-    if(event->refcount > 0)
-        event->refcount -= 1;
-    if(event->refcount == 0)
+    /*! The command queue drops its reference from the queue thread */
+    if(__atomic_sub_fetch(&(event->refcount), 1, __ATOMIC_ACQ_REL) == 0){
+        while(event->callbacks){
+            cb = event->callbacks;
+            event->callbacks = cb->next;
+            free(cb);
+        }
+        pthread_cond_destroy(&(event->event_cond));
+        pthread_mutex_destroy(&(event->event_mutex));
         free(event);
+    }
 
     return CL_SUCCESS;
 
@@ -69,6 +283,160 @@ cl_int clWaitForEvents(
 cl_uint num_events,
 const cl_event *event_list)
 {
+    cl_uint i;
+    cl_int ret = CL_SUCCESS;
+
     DEBUG("clWaitForEvents called\n");
+    if(num_events == 0 || event_list == NULL)
+        return CL_INVALID_VALUE;
+
+    for(i = 0; i < num_events; i++){
+        if(event_list[i] == NULL)
+            return CL_INVALID_EVENT;
+        if(event_list[i]->context != event_list[0]->context)
+            return CL_INVALID_CONTEXT;
+    }
+
+    for(i = 0; i < num_events; i++){
+        if(event_wait(event_list[i]) < 0)
+            ret = CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+    }
+    return ret;
+}
+
+
+
+cl_int clGetEventInfo(
+cl_event event,
+cl_event_info param_name,
+size_t param_value_size,
+void *param_value,
+size_t *param_value_size_ret)
+{
+    void *param;
+    size_t param_size;
+    cl_uint refcount;
+    cl_int status;
+
+    DEBUG("clGetEventInfo called\n");
+    if(event == NULL)
+        return CL_INVALID_EVENT;
+
+    switch(param_name){
+        case CL_EVENT_COMMAND_QUEUE:
+            param = &event->queue;
+            param_size = sizeof(cl_command_queue);
+            break;
+
+        case CL_EVENT_CONTEXT:
+            param = &event->context;
+            param_size = sizeof(cl_context);
+            break;
+
+        case CL_EVENT_COMMAND_TYPE:
+            param = &event->commandType;
+            param_size = sizeof(cl_command_type);
+            break;
+
+        case CL_EVENT_COMMAND_EXECUTION_STATUS:
+            pthread_mutex_lock(&(event->event_mutex));
+            status = event->status;
+            pthread_mutex_unlock(&(event->event_mutex));
+            param = &status;
+            param_size = sizeof(cl_int);
+            break;
+
+        case CL_EVENT_REFERENCE_COUNT:
+            refcount = __atomic_load_n(&(event->refcount), __ATOMIC_ACQUIRE);
+            param = &refcount;
+            param_size = sizeof(cl_uint);
+            break;
+
+        default:
+            return CL_INVALID_VALUE;
+    }
+
+    if(param_value_size_ret)
+        *param_value_size_ret = param_size;
+
+    if(param_value){
+        if(!param_value_size || param_value_size < param_size) return CL_INVALID_VALUE;
+        memcpy(param_value, param, param_size);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+
+cl_int clSetEventCallback(
+cl_event event,
+cl_int command_exec_callback_type,
+void (CL_CALLBACK *pfn_notify)(cl_event event, cl_int event_command_exec_status, void *user_data),
+void *user_data)
+{
+    EventCallback *cb;
+    cl_int status;
+
+    DEBUG("clSetEventCallback called\n");
+    if(event == NULL)
+        return CL_INVALID_EVENT;
+
+    if(pfn_notify == NULL || command_exec_callback_type != CL_COMPLETE)
+        return CL_INVALID_VALUE;
+
+    if( (cb = (EventCallback *)malloc(sizeof(EventCallback))) == NULL)
+        return CL_OUT_OF_HOST_MEMORY;
+    cb->type = command_exec_callback_type;
+    cb->pfn_notify = pfn_notify;
+    cb->user_data = user_data;
+
+    /*! Status already reached: call back straight away */
+    if((status = event_notify(event, cb)) <= command_exec_callback_type){
+        pfn_notify(event, status, user_data);
+        free(cb);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+
+cl_int clGetEventProfilingInfo(
+cl_event event,
+cl_profiling_info param_name,
+size_t param_value_size,
+void *param_value,
+size_t *param_value_size_ret)
+{
+    cl_ulong value;
+    cl_int status;
+
+    DEBUG("clGetEventProfilingInfo called\n");
+    if(event == NULL)
+        return CL_INVALID_EVENT;
+
+    if(param_name < CL_PROFILING_COMMAND_QUEUED || param_name > CL_PROFILING_COMMAND_END)
+        return CL_INVALID_VALUE;
+
+    /*! Only commands on profiling queues are reported, once complete */
+    if(!event->profiling)
+        return CL_PROFILING_INFO_NOT_AVAILABLE;
+
+    pthread_mutex_lock(&(event->event_mutex));
+    status = event->status;
+    value = event->profile[PROFILE_INDEX(param_name)];
+    pthread_mutex_unlock(&(event->event_mutex));
+    if(status != CL_COMPLETE)
+        return CL_PROFILING_INFO_NOT_AVAILABLE;
+
+    if(param_value_size_ret)
+        *param_value_size_ret = sizeof(cl_ulong);
+
+    if(param_value){
+        if(param_value_size < sizeof(cl_ulong)) return CL_INVALID_VALUE;
+        memcpy(param_value, &value, sizeof(cl_ulong));
+    }
+
     return CL_SUCCESS;
 }
@@ -7,9 +7,193 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include "cl_defs.h"
 #include "dev_interface.h"
 
+/*! Source of kernel ids, 0 is never handed out */
+static cl_uint kernel_next_id = 0;
+
+/*!
+* @brief Whether a character can be part of a C identifier
+*/
+static int kernel_ident_char(char c){
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || 
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+/*!
+* @brief Copy a string range without surrounding whitespace
+*/
+static char *kernel_strip(const char *start, const char *end){
+    while(start < end && (*start == ' ' || *start == '\t' || *start == '\n' || *start == '\r'))
+        start++;
+    while(end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r'))
+        end--;
+    return strndup(start, end - start);
+}
+
+/*! Sizes of the scalar types a kernel can take by value */
+static const struct { const char *name; size_t size; } kernel_scalar_types[] = {
+    {"char", 1}, {"uchar", 1}, {"short", 2}, {"ushort", 2}, {"int", 4}, {"uint", 4},
+    {"long", 8}, {"ulong", 8}, {"float", 4}, {"double", 8}, {"size_t", sizeof(size_t)}
+};
+
+/*!
+* @brief Size of a by-value type from its last word, 0 if it is not a known scalar
+*/
+static size_t kernel_scalar_size(const char *type){
+    const char *word = type + strlen(type);
+    size_t i;
+
+    while(word > type && kernel_ident_char(word[-1]))
+        word--;
+    for(i = 0; i < sizeof(kernel_scalar_types) / sizeof(kernel_scalar_types[0]); i++){
+        if(strcmp(word, kernel_scalar_types[i].name) == 0)
+            return kernel_scalar_types[i].size;
+    }
+    return 0;
+}
+
+/*!
+* @brief Record one parameter declaration, e.g. "volatile uint * output"
+* @return CL_SUCCESS, or CL_INVALID_KERNEL_DEFINITION if it cannot be used
+*/
+static cl_int kernel_parse_param(KernelArg *arg, const char *start, const char *end){
+    const char *name;
+    const char *star;
+    const char *word;
+    char *decl;
+
+    if((decl = kernel_strip(start, end)) == NULL)
+        return CL_OUT_OF_HOST_MEMORY;
+    /*! The type is everything before the parameter name */
+    for(name = decl + strlen(decl); name > decl && kernel_ident_char(name[-1]); name--);
+    if(name == decl || name[0] == '\0'){
+        free(decl);
+        return CL_INVALID_KERNEL_DEFINITION;
+    }
+    arg->type = kernel_strip(decl, name);
+    arg->isBuffer = strchr(arg->type, '*') != NULL;
+    arg->readOnly = CL_FALSE;
+    arg->typeSize = arg->isBuffer ? sizeof(cl_mem) : kernel_scalar_size(arg->type);
+    if(arg->isBuffer){
+        /*! const before the last '*' qualifies the data pointed to */
+        star = strrchr(arg->type, '*');
+        for(word = arg->type; (word = strstr(word, "const")) != NULL && word < star; word += 5){
+            if((word == arg->type || !kernel_ident_char(word[-1])) && !kernel_ident_char(word[5])){
+                arg->readOnly = CL_TRUE;
+            }
+        }
+    }
+    free(decl);
+    return CL_SUCCESS;
+}
+
+/*!
+* @brief Read the argument types of a kernel from the preprocessed source of
+*        its program. Programs created from binaries have no source; their 
+*        kernels take buffer arguments only.
+* @return CL_SUCCESS, CL_INVALID_KERNEL_NAME if the program has no such 
+*         kernel, or CL_INVALID_KERNEL_DEFINITION
+*/
+static cl_int kernel_parse_signature(cl_kernel kernel){
+    char path[PATH_MAX];
+    FILE *file;
+    long size;
+    char *text;
+    char *pos, *before, *start, *end;
+    size_t name_len = strlen(kernel->func_name);
+    int depth;
+    cl_int err = CL_INVALID_KERNEL_NAME;
+
+    kernel->hasSignature = CL_FALSE;
+    kernel->arg_count = 0;
+    snprintf(path, sizeof(path), "%s/program.i", kernel->program->buildDir);
+    if((file = fopen(path, "rb")) == NULL){
+        return kernel->program->createdWithBinary ? CL_SUCCESS : CL_INVALID_PROGRAM_EXECUTABLE;
+    }
+    text = NULL;
+    if(fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && 
+       fseek(file, 0, SEEK_SET) == 0 && (text = malloc(size + 1)) != NULL){
+        if(fread(text, 1, size, file) != (size_t)size){
+            free(text);
+            text = NULL;
+        }else{
+            text[size] = '\0';
+        }
+    }
+    fclose(file);
+    if(text == NULL)
+        return CL_OUT_OF_HOST_MEMORY;
+
+    /*! Look for "void <name> (" */
+    for(pos = text; (pos = strstr(pos, kernel->func_name)) != NULL; pos += name_len){
+        if((pos > text && kernel_ident_char(pos[-1])) || kernel_ident_char(pos[name_len]))
+            continue;
+        for(start = pos + name_len; *start == ' ' || *start == '\t' || *start == '\n'; start++);
+        if(*start != '(')
+            continue;
+        for(before = pos; before > text && (before[-1] == ' ' || before[-1] == '\t' || before[-1] == '\n'); before--);
+        if(before - text < 4 || strncmp(before - 4, "void", 4) != 0 || 
+           (before - text > 4 && kernel_ident_char(before[-5])))
+            continue;
+
+        /*! Split the parameter list at top level commas */
+        err = CL_SUCCESS;
+        depth = 0;
+        for(end = ++start; *end && err == CL_SUCCESS; end++){
+            if(*end == '(' || *end == '['){
+                depth++;
+            }else if(depth > 0 && (*end == ')' || *end == ']')){
+                depth--;
+            }else if(depth == 0 && (*end == ',' || *end == ')')){
+                if(kernel->arg_count == KERNEL_MAX_ARGS){
+                    err = CL_INVALID_KERNEL_DEFINITION;
+                    break;
+                }
+                if(*end == ')' && kernel->arg_count == 0){
+                    char *only = kernel_strip(start, end);
+                    int none = only && (only[0] == '\0' || strcmp(only, "void") == 0);
+                    free(only);
+                    if(none)
+                        break;
+                }
+                err = kernel_parse_param(&(kernel->args[kernel->arg_count]), start, end);
+                if(err == CL_SUCCESS)
+                    kernel->arg_count++;
+                if(*end == ')')
+                    break;
+                start = end + 1;
+            }
+        }
+        if(err == CL_SUCCESS && *end != ')')
+            err = CL_INVALID_KERNEL_DEFINITION;
+        break;
+    }
+    free(text);
+    if(err == CL_SUCCESS){
+        kernel->hasSignature = CL_TRUE;
+    }
+    DEBUG("%s: %s has %u arguments, status %d\n", __func__, kernel->func_name, kernel->arg_count, err);
+    return err;
+}
+
+
+/*!
+* @brief Drop argument types and bound buffers
+*/
+static void kernel_free_args(cl_kernel kernel){
+    cl_uint i;
+
+    for(i = 0; i < KERNEL_MAX_ARGS; i++){
+        free(kernel->args[i].type);
+        if(kernel->args[i].mem){
+            clReleaseMemObject(kernel->args[i].mem);
+        }
+    }
+}
+
 
 
 cl_kernel clCreateKernel(
@@ -20,12 +204,17 @@ cl_int *errcode_ret)
     cl_kernel kernel;
     char* name;
     size_t name_len;
+    cl_int err;
 
     DEBUG("clCreateKernel called\n");
     if(program == NULL){
         if(errcode_ret) *errcode_ret = CL_INVALID_PROGRAM;
         return NULL;
     }
+    if(program->buildStatus != CL_BUILD_SUCCESS){
+        if(errcode_ret) *errcode_ret = CL_INVALID_PROGRAM_EXECUTABLE;
+        return NULL;
+    }
     if((name_len = strlen(kernel_name)) < 1){
         if(errcode_ret) *errcode_ret = CL_INVALID_VALUE;
         return NULL;
@@ -36,15 +225,26 @@ cl_int *errcode_ret)
         return NULL;
     }
 
-    if( (kernel = (cl_kernel)malloc(sizeof(struct _cl_kernel))) == NULL){
+    if( (kernel = (cl_kernel)calloc(1, sizeof(struct _cl_kernel))) == NULL){
+        free(name);
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
         return NULL;
     }
     kernel->refcount = 1; /* implicit retain */
     kernel->arg_count = 0;
-    kernel->isNew = CL_TRUE;
+    kernel->id = __atomic_add_fetch(&kernel_next_id, 1, __ATOMIC_RELAXED);
     strncpy(name, kernel_name, name_len);
     kernel->func_name = name;
+    kernel->buildDir = NULL;
+    kernel->program = program;
+    if((err = kernel_parse_signature(kernel)) != CL_SUCCESS){
+        kernel_free_args(kernel);
+        free(name);
+        free(kernel);
+        if(errcode_ret) *errcode_ret = err;
+        return NULL;
+    }
+    clRetainProgram(program);
 
     if(errcode_ret) *errcode_ret = CL_SUCCESS;
 
@@ -60,7 +260,7 @@ cl_kernel kernel)
     if(kernel == NULL)
         return CL_INVALID_KERNEL;
 
-    kernel->refcount += 1;
+    __atomic_add_fetch(&(kernel->refcount), 1, __ATOMIC_ACQ_REL);
 
     return CL_SUCCESS;
 }
@@ -74,10 +274,17 @@ cl_kernel kernel)
     if(kernel == NULL)
         return CL_INVALID_KERNEL;
 
-    if(kernel->refcount > 0)
-        kernel->refcount -= 1;
-    if(kernel->refcount == 0)
+    /*! Every launch holds the kernel until the queue thread removes it */
+    if(__atomic_sub_fetch(&(kernel->refcount), 1, __ATOMIC_ACQ_REL) == 0){
+        if(kernel->buildDir){
+            build_dir_remove(kernel->buildDir);
+            free(kernel->buildDir);
+        }
+        kernel_free_args(kernel);
+        clReleaseProgram(kernel->program);
+        free(kernel->func_name);
         free(kernel);
+    }
 
     return CL_SUCCESS;
 }
@@ -90,12 +297,37 @@ cl_uint arg_index,
 size_t arg_size,
 const void *arg_value)
 {
+    KernelArg *arg;
+    cl_mem mem;
+
     DEBUG("clSetKernelArg called (index: %u, size: %zu)\n",arg_index, arg_size);
     if(kernel == NULL)
         return CL_INVALID_KERNEL;
+    if(arg_index >= KERNEL_MAX_ARGS || (kernel->hasSignature && arg_index >= kernel->arg_count))
+        return CL_INVALID_ARG_INDEX;
 
-    kernel->args[arg_index] = arg_size;
-    if((arg_index + 1) > kernel->arg_count){
+    arg = &(kernel->args[arg_index]);
+    if(!kernel->hasSignature){
+        arg->isBuffer = CL_TRUE;
+    }
+    if(arg->isBuffer){
+        if(arg_size != sizeof(cl_mem))
+            return CL_INVALID_ARG_SIZE;
+        mem = arg_value ? *(const cl_mem *)arg_value : NULL;
+        if(mem) clRetainMemObject(mem);
+        if(arg->mem) clReleaseMemObject(arg->mem);
+        arg->mem = mem;
+    }else{
+        if(arg_value == NULL)
+            return CL_INVALID_ARG_VALUE;
+        if(arg_size == 0 || arg_size > KERNEL_ARG_MAX_SIZE || 
+           (arg->typeSize != 0 && arg_size != arg->typeSize))
+            return CL_INVALID_ARG_SIZE;
+        memcpy(arg->value, arg_value, arg_size);
+    }
+    arg->size = arg_size;
+    arg->set = CL_TRUE;
+    if(!kernel->hasSignature && (arg_index + 1) > kernel->arg_count){
         kernel->arg_count = arg_index + 1;
     }
     DEBUG("clSetKernelArg arg_count %d)\n", kernel->arg_count);
@@ -105,21 +337,53 @@ const void *arg_value)
 
 
 
+/*!
+* @brief Lay out the argument block: buffers as 64 bit device offsets, 
+*        by-value arguments aligned to their size up to 16 bytes
+* @param offsets Receives the offset of each argument
+* @return Size of the block
+*/
+size_t kernel_arg_layout(cl_kernel kernel, size_t *offsets){
+    size_t total = 0;
+    size_t size, align;
+    cl_uint i;
+
+    for(i = 0; i < kernel->arg_count; i++){
+        size = kernel->args[i].isBuffer ? sizeof(uint64_t) : kernel->args[i].size;
+        for(align = 1; align < size && align < 16; align <<= 1);
+        total = (total + align - 1) & ~(align - 1);
+        offsets[i] = total;
+        total += size;
+    }
+    return total;
+}
+
+
+
+/*!
+* @brief Describe the argument layout, which is what the generated wrapper 
+*        depends on. One line "offset size type" per argument.
+* @return String to be freed by the caller, NULL if out of memory
+*/
 char* get_kernel_args(cl_kernel kernel){
-    int i, count;
-    int total = 0;
-    char arg_line[1024];
+    size_t offsets[KERNEL_MAX_ARGS];
+    size_t len = 1;
     char* arg_str;
+    char* pos;
+    cl_uint i;
 
-    if( (arg_str = (char*)malloc(sizeof(char)*512)) == NULL){
+    kernel_arg_layout(kernel, offsets);
+    for(i = 0; i < kernel->arg_count; i++){
+        len += 64 + (kernel->args[i].type ? strlen(kernel->args[i].type) : 0);
+    }
+    if( (arg_str = (char*)malloc(len)) == NULL){
         return NULL;
     }
-    count = kernel->arg_count;
-    arg_str[0] = '\0';
-    for(i=0; i<count; i++){
-        sprintf(arg_line, "%d %zu\n", total, kernel->args[i]);
-        strcat(arg_str, arg_line);
-        total += kernel->args[i];
+    pos = arg_str;
+    *pos = '\0';
+    for(i = 0; i < kernel->arg_count; i++){
+        pos += sprintf(pos, "%zu %zu %s\n", offsets[i], kernel->args[i].size, 
+                       kernel->args[i].type ? kernel->args[i].type : "buffer");
     }
 
     return arg_str;
@@ -127,6 +391,20 @@ char* get_kernel_args(cl_kernel kernel){
 
 
 
+/*!
+* @brief Release what a launch holds on to
+*/
+void kernel_params_release(ND_Kernel_Cmd_Params *params){
+    cl_uint i;
+
+    for(i = 0; i < params->numBuffers; i++){
+        clReleaseMemObject(params->buffers[i]);
+    }
+    clReleaseKernel(params->kernel);
+}
+
+
+
 cl_int clEnqueueNDRangeKernel(
 cl_command_queue command_queue,
 cl_kernel kernel,
@@ -139,36 +417,96 @@ const cl_event *event_wait_list,
 cl_event *event)
 {
     QueueCommand *newCmd;
-    CommPacket_t *payload;
-    const int cmdlen = sizeof(ND_Kernel_Cmd_Params);
-    pthread_mutex_lock(&(command_queue->queue_mutex));
-    DEBUG("%s called\n", __func__);
+    ND_Kernel_Cmd_Params *params;
+    size_t offsets[KERNEL_MAX_ARGS];
+    size_t argSize;
+    uint64_t devOffset;
+    MemAccess access[KERNEL_MAX_ARGS];
+    KernelArg *arg;
+    cl_uint i;
+    cl_int err;
     
-    newCmd = queue_add(command_queue);
+    if(command_queue == NULL)
+        return CL_INVALID_COMMAND_QUEUE;
+    if(kernel == NULL)
+        return CL_INVALID_KERNEL;
+    if(work_dim < 1 || work_dim > 3)
+        return CL_INVALID_WORK_DIMENSION;
+    if(global_work_size == NULL)
+        return CL_INVALID_GLOBAL_WORK_SIZE;
+    /*! Work item IDs travel as 32 bit values */
+    for(i = 0; i < work_dim; i++){
+        if(global_work_size[i] == 0 || global_work_size[i] > UINT32_MAX)
+            return CL_INVALID_GLOBAL_WORK_SIZE;
+        if(global_work_offset && global_work_offset[i] > UINT32_MAX - global_work_size[i])
+            return CL_INVALID_GLOBAL_OFFSET;
+    }
+    if((err = event_check_wait_list(num_events_in_wait_list, event_wait_list)) != CL_SUCCESS)
+        return err;
+    for(i = 0; i < kernel->arg_count; i++){
+        if(!kernel->args[i].set)
+            return CL_INVALID_KERNEL_ARGS;
+    }
+    argSize = kernel_arg_layout(kernel, offsets);
+    if(argSize > MORACL_ARG_BLOCK_SIZE)
+        return CL_INVALID_KERNEL_ARGS;
     
-    payload = calloc(cmdlen, 1);
-    if(NULL == payload){
-        pthread_mutex_unlock(&(command_queue->queue_mutex));
+    /*! Use the payload area of the command object for parameters*/
+    params = calloc(sizeof(ND_Kernel_Cmd_Params) + argSize, 1);
+    if(NULL == params){
         return CL_OUT_OF_HOST_MEMORY;
     }
+    params->globalWorkSize.globalX = global_work_size[0];
+    params->globalWorkSize.globalY = (work_dim >=2) ? global_work_size[1] : 1;
+    params->globalWorkSize.globalZ = (work_dim >=3) ? global_work_size[2] : 1;
+    if(global_work_offset){
+        params->globalWorkOffset.globalX = global_work_offset[0];
+        params->globalWorkOffset.globalY = (work_dim >=2) ? global_work_offset[1] : 0;
+        params->globalWorkOffset.globalZ = (work_dim >=3) ? global_work_offset[2] : 0;
+    }
+    params->kernel = kernel;
+    params->argSize = argSize;
     
+    /*! Arguments are taken as they are now, later clSetKernelArg calls do 
+     *  not affect this launch. The buffers it touches order it against 
+     *  other commands. */
+    for(i = 0; i < kernel->arg_count; i++){
+        arg = &(kernel->args[i]);
+        if(!arg->isBuffer){
+            memcpy(params->args + offsets[i], arg->value, arg->size);
+            continue;
+        }
+        devOffset = arg->mem ? arg->mem->offset : UINT64_MAX;
+        memcpy(params->args + offsets[i], &devOffset, sizeof(devOffset));
+        if(arg->mem == NULL)
+            continue;
+        access[params->numBuffers].start = arg->mem->offset;
+        access[params->numBuffers].end = arg->mem->offset + arg->mem->size;
+        access[params->numBuffers].write = !arg->readOnly;
+        clRetainMemObject(arg->mem);
+        params->bufferWrites[params->numBuffers] = !arg->readOnly;
+        params->buffers[params->numBuffers++] = arg->mem;
+    }
+    clRetainKernel(kernel);
+    
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    DEBUG("%s called\n", __func__);
+    
+    newCmd = queue_add(command_queue, CL_COMMAND_NDRANGE_KERNEL, access, params->numBuffers, 
+                       num_events_in_wait_list, event_wait_list);
     if(NULL == newCmd){
-        free(payload);
         pthread_mutex_unlock(&(command_queue->queue_mutex));
+        kernel_params_release(params);
+        free(params);
         return CL_OUT_OF_HOST_MEMORY;
     }
     
-    newCmd->eventStatus = CL_QUEUED;
-    newCmd->commandType = CL_COMMAND_NDRANGE_KERNEL;
-    newCmd->payload = payload;
+    newCmd->payload = params;
     newCmd->ret = NULL;
-    
-    /*! Use the payload area of the command object for parameters*/
-    ND_Kernel_Cmd_Params *params = (ND_Kernel_Cmd_Params *)payload;
-    params->globalWorkSize.globalX = global_work_size[0];
-    params->globalWorkSize.globalY = (work_dim >=2) ? global_work_size[1] : 1;
-    params->globalWorkSize.globalZ = (work_dim >=3) ? global_work_size[2] : 1;
-    params->kernel = kernel;
+    if(event){
+        clRetainEvent(newCmd->event);
+        *event = newCmd->event;
+    }
     pthread_mutex_unlock(&(command_queue->queue_mutex));
     return CL_SUCCESS;
 }
@@ -10,10 +10,191 @@
 #include "cl_defs.h"
 #include "dev_interface.h"
 #include <arpa/inet.h>
+#include <endian.h>
 
 
 
 
+/*! Every context has an address space of its own on the device, and an 
+ *  allocator of its own to match. Free ranges are kept in address order so 
+ *  neighbours can be merged on release. Live contexts are listed for the 
+ *  device's statistics. */
+static pthread_mutex_t mem_contexts_mutex = PTHREAD_MUTEX_INITIALIZER;
+static cl_context mem_contexts = NULL;
+
+/*! 
+* @brief Round a buffer size up to the device's base address alignment
+*/
+size_t mem_align(size_t size){
+    const size_t align = MEM_BASE_ADDR_ALIGN >> 3;
+    return (size + align - 1) & ~(align - 1);
+}
+
+/*! 
+* @brief Put the whole of a new context's device memory on its free list
+* @param context Context, its devices set
+* @return CL_SUCCESS or CL_OUT_OF_HOST_MEMORY
+*/
+cl_int mem_context_init(cl_context context){
+    if((context->mem_free_list = (MemBlock *)malloc(sizeof(MemBlock))) == NULL)
+        return CL_OUT_OF_HOST_MEMORY;
+    context->mem_free_list->offset = 0;
+    context->mem_free_list->size = context->devices[0]->global_mem_size;
+    context->mem_free_list->next = NULL;
+    memset(&context->mem_stats, 0, sizeof(context->mem_stats));
+    context->mem_stats.size = context->devices[0]->global_mem_size;
+    pthread_mutex_init(&context->mem_mutex, NULL);
+    
+    pthread_mutex_lock(&mem_contexts_mutex);
+    context->mem_next = mem_contexts;
+    mem_contexts = context;
+    pthread_mutex_unlock(&mem_contexts_mutex);
+    return CL_SUCCESS;
+}
+
+/*! 
+* @brief Drop the allocator of a context being released, its buffers are gone
+*/
+void mem_context_release(cl_context context){
+    cl_context *link;
+    MemBlock *block;
+    
+    pthread_mutex_lock(&mem_contexts_mutex);
+    for(link = &mem_contexts; *link != context; link = &((*link)->mem_next));
+    *link = context->mem_next;
+    pthread_mutex_unlock(&mem_contexts_mutex);
+    
+    while((block = context->mem_free_list) != NULL){
+        context->mem_free_list = block->next;
+        free(block);
+    }
+    pthread_mutex_destroy(&context->mem_mutex);
+}
+
+/*! 
+* @brief Reserve device memory, first fit by address
+* @param context Context whose address space the memory is in
+* @param size Bytes needed, already aligned
+* @param offset Returns the device address of the range
+* @return CL_SUCCESS, or CL_MEM_OBJECT_ALLOCATION_FAILURE when no free range is large enough
+*/
+static cl_int mem_alloc(cl_context context, size_t size, size_t *offset){
+    MemBlock **link;
+    MemBlock *block;
+    
+    pthread_mutex_lock(&context->mem_mutex);
+    for(link = &context->mem_free_list; *link; link = &((*link)->next)){
+        if((*link)->size >= size)
+            break;
+    }
+    if(*link == NULL){
+        context->mem_stats.failures++;
+        pthread_mutex_unlock(&context->mem_mutex);
+        DEBUG("%s: No free range of %zd bytes.\n", __func__, size);
+        return CL_MEM_OBJECT_ALLOCATION_FAILURE;
+    }
+    block = *link;
+    *offset = block->offset;
+    block->offset += size;
+    block->size -= size;
+    if(block->size == 0){
+        *link = block->next;
+        free(block);
+    }
+    context->mem_stats.used += size;
+    context->mem_stats.allocations++;
+    if(context->mem_stats.used > context->mem_stats.high_water)
+        context->mem_stats.high_water = context->mem_stats.used;
+    pthread_mutex_unlock(&context->mem_mutex);
+    return CL_SUCCESS;
+}
+
+/*! 
+* @brief Return device memory to the free list, merging it with adjacent free ranges
+* @param context Context the memory was allocated in
+* @param offset Device address of the range
+* @param size Bytes, aligned as they were allocated
+*/
+static void mem_free(cl_context context, size_t offset, size_t size){
+    MemBlock **link;
+    MemBlock *prev = NULL;
+    MemBlock *next;
+    MemBlock *block;
+    
+    pthread_mutex_lock(&context->mem_mutex);
+    for(link = &context->mem_free_list; *link && (*link)->offset < offset; link = &((*link)->next)){
+        prev = *link;
+    }
+    next = *link;
+    context->mem_stats.used -= size;
+    context->mem_stats.allocations--;
+    
+    if(prev && prev->offset + prev->size == offset){
+        /*! Grow the range below, then swallow the one above if they now touch */
+        prev->size += size;
+        if(next && prev->offset + prev->size == next->offset){
+            prev->size += next->size;
+            prev->next = next->next;
+            free(next);
+        }
+    }else if(next && offset + size == next->offset){
+        next->offset = offset;
+        next->size += size;
+    }else if((block = (MemBlock *)malloc(sizeof(MemBlock))) != NULL){
+        block->offset = offset;
+        block->size = size;
+        block->next = next;
+        *link = block;
+    }else{
+        /*! Without a node the range stays lost, which is only a leak */
+        DEBUG("%s: Out of host memory, dropping %zd bytes.\n", __func__, size);
+    }
+    pthread_mutex_unlock(&context->mem_mutex);
+}
+
+/*! 
+* @brief Snapshot of a context's device memory allocator, see CL_CONTEXT_MEMORY_STATISTICS_NOVEL
+*/
+void mem_statistics(cl_context context, cl_memory_statistics_novel *stats){
+    MemBlock *block;
+    
+    pthread_mutex_lock(&context->mem_mutex);
+    *stats = context->mem_stats;
+    stats->largest_free = 0;
+    stats->free_blocks = 0;
+    for(block = context->mem_free_list; block; block = block->next){
+        stats->free_blocks++;
+        if(block->size > stats->largest_free)
+            stats->largest_free = block->size;
+    }
+    pthread_mutex_unlock(&context->mem_mutex);
+}
+
+/*! 
+* @brief Device memory of every live context summed up, see CL_DEVICE_MEMORY_STATISTICS_NOVEL
+*/
+void mem_device_statistics(cl_memory_statistics_novel *stats){
+    cl_memory_statistics_novel one;
+    cl_context context;
+    
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&mem_contexts_mutex);
+    for(context = mem_contexts; context; context = context->mem_next){
+        mem_statistics(context, &one);
+        stats->size += one.size;
+        stats->used += one.used;
+        stats->high_water += one.high_water;
+        if(one.largest_free > stats->largest_free)
+            stats->largest_free = one.largest_free;
+        stats->allocations += one.allocations;
+        stats->free_blocks += one.free_blocks;
+        stats->failures += one.failures;
+    }
+    pthread_mutex_unlock(&mem_contexts_mutex);
+}
+
+
+
 cl_mem clCreateBuffer(
 cl_context context,
 cl_mem_flags flags,
@@ -22,16 +203,30 @@ void *host_ptr,
 cl_int *errcode_ret)
 {
     cl_mem mem;
+    cl_int err;
 
     DEBUG("clCreateBuffer called\n");
+    if(context == NULL){
+        if(errcode_ret) *errcode_ret = CL_INVALID_CONTEXT;
+        return NULL;
+    }
+    if(size == 0 || size > context->devices[0]->global_mem_size){
+        if(errcode_ret) *errcode_ret = CL_INVALID_BUFFER_SIZE;
+        return NULL;
+    }
     if( ((mem = (cl_mem)malloc(sizeof(struct _cl_mem))) == NULL) ){
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
         return NULL;
     }
+    if((err = mem_alloc(context, mem_align(size), &mem->offset)) != CL_SUCCESS){
+        free(mem);
+        if(errcode_ret) *errcode_ret = err;
+        return NULL;
+    }
     mem->refcount = 1; /* implicit retain */
-    mem->offset = context->mem_alloc_offset;
     mem->size = size;
-    context->mem_alloc_offset += size;
+    mem->context = context;
+    clRetainContext(context);
     if(errcode_ret) *errcode_ret = CL_SUCCESS;
     
     return mem;
@@ -46,7 +241,7 @@ cl_mem memobj)
     if(memobj == NULL)
         return CL_INVALID_MEM_OBJECT;
 
-    memobj->refcount += 1;
+    __atomic_add_fetch(&(memobj->refcount), 1, __ATOMIC_ACQ_REL);
 
     return CL_SUCCESS;
 }
@@ -60,9 +255,10 @@ cl_mem memobj)
     if(memobj == NULL)
         return CL_INVALID_MEM_OBJECT;
 
-    if(memobj->refcount > 0)
-        memobj->refcount -= 1;
-    if(memobj->refcount == 0){
+    /*! Queued commands let go of the buffers they use from the queue thread */
+    if(__atomic_sub_fetch(&(memobj->refcount), 1, __ATOMIC_ACQ_REL) == 0){
+        mem_free(memobj->context, memobj->offset, mem_align(memobj->size));
+        clReleaseContext(memobj->context);
         free(memobj);
     }
     return CL_SUCCESS;
@@ -70,6 +266,26 @@ cl_mem memobj)
 
 
 
+/*! 
+* @brief Check a transfer against the buffer it names. Buffers are packed 
+*        next to each other in device memory, and the device only checks 
+*        against the whole address space.
+* @return CL_SUCCESS, CL_INVALID_MEM_OBJECT, CL_INVALID_CONTEXT if the buffer
+*         belongs to another context than the queue, or CL_INVALID_VALUE if
+*         [offset, offset + cb) is not within the buffer
+*/
+static cl_int mem_check_access(cl_command_queue command_queue, cl_mem buffer, size_t offset, size_t cb){
+    if(buffer == NULL)
+        return CL_INVALID_MEM_OBJECT;
+    if(buffer->context != command_queue->context)
+        return CL_INVALID_CONTEXT;
+    if(offset > buffer->size || cb > buffer->size - offset)
+        return CL_INVALID_VALUE;
+    return CL_SUCCESS;
+}
+
+
+
 cl_int clEnqueueReadBuffer(
 cl_command_queue command_queue,
 cl_mem buffer,
@@ -83,35 +299,65 @@ cl_event *event)
 {
     QueueCommand *newCmd;
     CommPacket_t *payload;
-    const int cmdlen = 4 + 8;
-    pthread_mutex_lock(&(command_queue->queue_mutex));
-    DEBUG("%s called\n", __func__);
-    newCmd = queue_add(command_queue);
+    MemAccess access;
+    cl_event waitEvent = NULL;
+    cl_int err;
+    const int cmdlen = COMM_HEADER_LENGTH + sizeof(MemReadWrite_t);
+    
+    if(command_queue == NULL)
+        return CL_INVALID_COMMAND_QUEUE;
+    if((err = mem_check_access(command_queue, buffer, offset, cb)) != CL_SUCCESS)
+        return err;
+    if(ptr == NULL)
+        return CL_INVALID_VALUE;
+    if((err = event_check_wait_list(num_events_in_wait_list, event_wait_list)) != CL_SUCCESS)
+        return err;
     
     payload = calloc(cmdlen, 1);
     if(NULL == payload){
-        pthread_mutex_unlock(&(command_queue->queue_mutex));
         return CL_OUT_OF_HOST_MEMORY;
     }
     
+    access.start = buffer->offset + offset;
+    access.end = access.start + cb;
+    access.write = CL_FALSE;
+    
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    DEBUG("%s called\n", __func__);
+    newCmd = queue_add(command_queue, CL_COMMAND_READ_BUFFER, &access, 1, 
+                       num_events_in_wait_list, event_wait_list);
     if(NULL == newCmd){
         free(payload);
         pthread_mutex_unlock(&(command_queue->queue_mutex));
         return CL_OUT_OF_HOST_MEMORY;
     }
     
-    newCmd->eventStatus = CL_QUEUED;
-    newCmd->commandType = CL_COMMAND_READ_BUFFER;
     newCmd->payload = payload;
     newCmd->ret = ptr;
+    newCmd->buffer = buffer;
+    clRetainMemObject(buffer);
     
     payload->version = MORACL_PROTOCOL_VERSION;  
     payload->cmdId = MEM_READ_CMD;
-    payload->payload.read.offset = htonl(buffer->offset);
-    payload->payload.read.accessLength = htonl(cb);
+    payload->payload.read.offset = htobe64(buffer->offset + offset);
+    payload->payload.read.accessLength = htobe64(cb);
     DEBUG("%s: Queue Read %d.\n", __func__, cb);
-    payload->length = htons(cmdlen);
+    payload->length = htonl(cmdlen);
+    if(event){
+        clRetainEvent(newCmd->event);
+        *event = newCmd->event;
+    }
+    if(blocking_read == CL_TRUE){
+        clRetainEvent(newCmd->event);
+        waitEvent = newCmd->event;
+    }
     pthread_mutex_unlock(&(command_queue->queue_mutex));
+
+    if(waitEvent){
+        err = queue_wait_event(command_queue, waitEvent);
+        clReleaseEvent(waitEvent);
+        return err;
+    }
     return CL_SUCCESS;
 }
 
@@ -130,38 +376,75 @@ cl_event *event)
 {
     QueueCommand *newCmd;
     CommPacket_t *payload;
-    int cmdlen = 4 + 8 + cb;
-    pthread_mutex_lock(&(command_queue->queue_mutex));
-    DEBUG("%s called\n", __func__);
-    newCmd = queue_add(command_queue);
-    DEBUG("%s Added\n", __func__);
-    payload = calloc(cmdlen, 1);
+    MemAccess access;
+    cl_event waitEvent = NULL;
+    cl_int err;
+    const int hdrlen = COMM_HEADER_LENGTH + sizeof(MemReadWrite_t);
+    
+    if(command_queue == NULL)
+        return CL_INVALID_COMMAND_QUEUE;
+    if((err = mem_check_access(command_queue, buffer, offset, cb)) != CL_SUCCESS)
+        return err;
+    if(ptr == NULL)
+        return CL_INVALID_VALUE;
+    if((err = event_check_wait_list(num_events_in_wait_list, event_wait_list)) != CL_SUCCESS)
+        return err;
+    
+    /*! A blocking write is sent straight from ptr, only a non-blocking 
+     *  one needs its own copy of the data */
+    payload = calloc(hdrlen + ((blocking_write == CL_TRUE) ? 0 : cb), 1);
     if(NULL == payload){
-        pthread_mutex_unlock(&(command_queue->queue_mutex));
         return CL_OUT_OF_HOST_MEMORY;
     }
     
+    access.start = buffer->offset + offset;
+    access.end = access.start + cb;
+    access.write = CL_TRUE;
+    
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    DEBUG("%s called\n", __func__);
+    newCmd = queue_add(command_queue, CL_COMMAND_WRITE_BUFFER, &access, 1, 
+                       num_events_in_wait_list, event_wait_list);
+    DEBUG("%s Added\n", __func__);
     if(NULL == newCmd){
         free(payload);
         pthread_mutex_unlock(&(command_queue->queue_mutex));
         return CL_OUT_OF_HOST_MEMORY;
     }
     
-    
-    newCmd->eventStatus = CL_QUEUED;
-    newCmd->commandType = CL_COMMAND_WRITE_BUFFER;
     newCmd->payload = payload;
-    
-    newCmd->ret = (void *)ptr;
+    /*! Released with the command, the range cannot be handed out again 
+     *  while the write is queued */
+    newCmd->buffer = buffer;
+    clRetainMemObject(buffer);
     
     payload->version = MORACL_PROTOCOL_VERSION;  
     payload->cmdId = MEM_WRITE_CMD;
-    payload->payload.write.offset = htonl(buffer->offset);
-    payload->payload.write.accessLength = htonl(cb);
-    memcpy(payload->payload.write.data, ptr, cb);
-    payload->length = htons(cmdlen);
+    payload->payload.write.offset = htobe64(buffer->offset + offset);
+    payload->payload.write.accessLength = htobe64(cb);
+    payload->length = htonl(hdrlen); /*! Sent in chunks, see queue_write_chunks */
+    if(blocking_write == CL_TRUE){
+        newCmd->ret = (void *)ptr;
+    }else{
+        memcpy(payload->payload.write.data, ptr, cb);
+        newCmd->ret = payload->payload.write.data;
+    }
+    if(event){
+        clRetainEvent(newCmd->event);
+        *event = newCmd->event;
+    }
     
+    if(blocking_write == CL_TRUE){
+        clRetainEvent(newCmd->event);
+        waitEvent = newCmd->event;
+    }
     pthread_mutex_unlock(&(command_queue->queue_mutex));
+
+    if(waitEvent){
+        err = queue_wait_event(command_queue, waitEvent);
+        clReleaseEvent(waitEvent);
+        return err;
+    }
     return CL_SUCCESS;
 }
 
@@ -179,15 +462,27 @@ cl_int *errcode_ret)
 {
     QueueCommand *newCmd;
     CommPacket_t *payload;
+    MemAccess access;
+    cl_event waitEvent = NULL;
     void *mappedMemory;
-    const int cmdlen = 4 + 8;
-    pthread_mutex_lock(&(command_queue->queue_mutex));
-    DEBUG("%s called\n", __func__);
-    newCmd = queue_add(command_queue);
+    cl_int err;
+    const int cmdlen = COMM_HEADER_LENGTH + sizeof(MemReadWrite_t);
+    
+    if(command_queue == NULL){
+        if(errcode_ret) *errcode_ret = CL_INVALID_COMMAND_QUEUE;
+        return NULL;
+    }
+    if((err = mem_check_access(command_queue, buffer, offset, cb)) != CL_SUCCESS){
+        if(errcode_ret) *errcode_ret = err;
+        return NULL;
+    }
+    if((err = event_check_wait_list(num_events_in_wait_list, event_wait_list)) != CL_SUCCESS){
+        if(errcode_ret) *errcode_ret = err;
+        return NULL;
+    }
     
     mappedMemory = calloc(cb, 1);
     if(NULL == mappedMemory){
-        pthread_mutex_unlock(&(command_queue->queue_mutex));
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
         return NULL;
     }
@@ -195,37 +490,55 @@ cl_int *errcode_ret)
     payload = calloc(cmdlen, 1);
     if(NULL == payload){
         free(mappedMemory);
-        pthread_mutex_unlock(&(command_queue->queue_mutex));
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
         return NULL;
     }
     
+    access.start = buffer->offset + offset;
+    access.end = access.start + cb;
+    access.write = CL_FALSE;
+    
+    pthread_mutex_lock(&(command_queue->queue_mutex));
+    DEBUG("%s called\n", __func__);
+    newCmd = queue_add(command_queue, CL_COMMAND_MAP_BUFFER, &access, 1, 
+                       num_events_in_wait_list, event_wait_list);
     if(NULL == newCmd){
         free(mappedMemory);
         free(payload);
+        pthread_mutex_unlock(&(command_queue->queue_mutex));
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
         return NULL;
     }
     
     DEBUG("Command: %p\n", newCmd);
-    newCmd->eventStatus = CL_QUEUED;
-    newCmd->commandType = CL_COMMAND_MAP_BUFFER;
     newCmd->payload = payload;
     newCmd->ret = mappedMemory;
+    newCmd->buffer = buffer;
+    clRetainMemObject(buffer);
     
     payload->version = MORACL_PROTOCOL_VERSION;  
     payload->cmdId = MEM_READ_CMD;
-    payload->payload.read.offset = htonl(buffer->offset);
-    payload->payload.read.accessLength = htonl(cb);
+    payload->payload.read.offset = htobe64(buffer->offset + offset);
+    payload->payload.read.accessLength = htobe64(cb);
     DEBUG("%s: Queue Read %d.\n", __func__, cb);
-    payload->length = htons(cmdlen);
+    payload->length = htonl(cmdlen);
+    if(event){
+        clRetainEvent(newCmd->event);
+        *event = newCmd->event;
+    }
+    if(blocking_map == CL_TRUE){
+        clRetainEvent(newCmd->event);
+        waitEvent = newCmd->event;
+    }
     pthread_mutex_unlock(&(command_queue->queue_mutex));
 
-    if(blocking_map == CL_TRUE){
-        clFinish(command_queue);
+    err = CL_SUCCESS;
+    if(waitEvent){
+        err = queue_wait_event(command_queue, waitEvent);
+        clReleaseEvent(waitEvent);
     }
     
-    if(errcode_ret) *errcode_ret = CL_SUCCESS;
+    if(errcode_ret) *errcode_ret = err;
     return mappedMemory;
 }
 
@@ -238,20 +551,42 @@ const cl_event *event_wait_list,
 cl_event *event)
 {
     QueueCommand *newCmd;
-    const int cmdlen = 4 + 8;
+    MemAccess access;
+    cl_int err;
+    
+    if(command_queue == NULL)
+        return CL_INVALID_COMMAND_QUEUE;
+    if(memobj == NULL)
+        return CL_INVALID_MEM_OBJECT;
+    if(memobj->context != command_queue->context)
+        return CL_INVALID_CONTEXT;
+    if((err = event_check_wait_list(num_events_in_wait_list, event_wait_list)) != CL_SUCCESS)
+        return err;
+    
+    /*! Orders the unmap after the map it releases */
+    access.start = memobj->offset;
+    access.end = memobj->offset + memobj->size;
+    access.write = CL_TRUE;
+    
     pthread_mutex_lock(&(command_queue->queue_mutex));
     DEBUG("%s called\n", __func__);
-    newCmd = queue_add(command_queue);
+    newCmd = queue_add(command_queue, CL_COMMAND_UNMAP_MEM_OBJECT, &access, 1, 
+                       num_events_in_wait_list, event_wait_list);
     
     if(NULL == newCmd){
+        pthread_mutex_unlock(&(command_queue->queue_mutex));
         return CL_OUT_OF_HOST_MEMORY;
     }
     
     DEBUG("Command: %p\n", newCmd);
-    newCmd->eventStatus = CL_QUEUED;
-    newCmd->commandType = CL_COMMAND_UNMAP_MEM_OBJECT;
     newCmd->payload = NULL;
     newCmd->ret = mapped_ptr;
+    newCmd->buffer = memobj;
+    clRetainMemObject(memobj);
+    if(event){
+        clRetainEvent(newCmd->event);
+        *event = newCmd->event;
+    }
     
     pthread_mutex_unlock(&(command_queue->queue_mutex));
     
@@ -8,9 +8,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <limits.h>
 #include "cl_defs.h"
 #include "dev_interface.h"
 
+/*! Built by buildprogram.sh: the object, and the preprocessed source kernel
+ *  signatures are read from and kernel images are compiled from */
+static const char *program_files[] = {"program.o", "program.i", NULL};
+
 cl_program clCreateProgramWithSource(
 cl_context context,
 cl_uint count,
@@ -20,7 +25,7 @@ cl_int *errcode_ret)
 {
     cl_program prog;
     char cmd[256];
-    int line;
+    cl_uint line;
 
     DEBUG("clCreateProgramWithSource called\n");
     if( (prog = (cl_program)malloc(sizeof(struct _cl_program))) == NULL){
@@ -77,6 +82,17 @@ cl_int *errcode_ret)
     }
     prog->hasBinary = CL_FALSE;
     prog->createdWithBinary = CL_FALSE;
+    if((prog->buildDir = build_dir_create()) == NULL){
+        for(line = 0; line < count; line++){
+            free(prog->source.strings[line]);
+        }
+        free(prog->source.lengths);
+        free(prog->source.strings);
+        free(prog);
+        if(errcode_ret) *errcode_ret = CL_OUT_OF_RESOURCES;
+        return NULL;
+    }
+    pthread_mutex_init(&(prog->build_mutex), NULL);
     if(errcode_ret) *errcode_ret = CL_SUCCESS;
 
     return prog;
@@ -90,6 +106,8 @@ cl_program clCreateProgramWithBinary (  cl_context context,
         cl_int *binary_status,
         cl_int *errcode_ret){
     cl_program prog;        
+    char path[PATH_MAX];
+    FILE *binaryFile;
     DEBUG("Entering %s\n", __func__);
     if( (prog = (cl_program)malloc(sizeof(struct _cl_program))) == NULL){
         if(binary_status) *binary_status = CL_OUT_OF_HOST_MEMORY;
@@ -102,13 +120,22 @@ cl_program clCreateProgramWithBinary (  cl_context context,
     prog->buildOptions = NULL;
     prog->source.count = 0;
     prog->source.strings = NULL;
+    if((prog->buildDir = build_dir_create()) == NULL){
+        free(prog);
+        if(binary_status) *binary_status = CL_OUT_OF_RESOURCES;
+        if(errcode_ret) *errcode_ret = CL_OUT_OF_RESOURCES;
+        return NULL;
+    }
     
-    FILE *binaryFile = fopen("program.o", "wb+");
+    snprintf(path, sizeof(path), "%s/program.o", prog->buildDir);
+    binaryFile = fopen(path, "wb+");
     if(binaryFile != NULL){
         fwrite(binaries[0], lengths[0], 1, binaryFile);
         prog->binarySize = lengths[0];
         fclose(binaryFile);
     }else{
+        build_dir_remove(prog->buildDir);
+        free(prog->buildDir);
         free(prog);
         if(binary_status) *binary_status = CL_OUT_OF_HOST_MEMORY;
         if(errcode_ret) *errcode_ret = CL_OUT_OF_HOST_MEMORY;
@@ -118,6 +145,7 @@ cl_program clCreateProgramWithBinary (  cl_context context,
     if(errcode_ret) *errcode_ret = CL_SUCCESS;
     prog->hasBinary = CL_TRUE;
     prog->createdWithBinary = CL_TRUE;
+    pthread_mutex_init(&(prog->build_mutex), NULL);
     return prog;
 }
 
@@ -129,7 +157,7 @@ cl_program program)
     if(program == NULL)
         return CL_INVALID_PROGRAM;
 
-    program->refcount += 1;
+    __atomic_add_fetch(&(program->refcount), 1, __ATOMIC_ACQ_REL);
 
     return CL_SUCCESS;
 }
@@ -143,9 +171,7 @@ cl_program program)
     if(program == NULL)
         return CL_INVALID_PROGRAM;
 
-    if(program->refcount > 0)
-        program->refcount -= 1;
-    if(program->refcount == 0){
+    if(__atomic_sub_fetch(&(program->refcount), 1, __ATOMIC_ACQ_REL) == 0){
         if(program->createdWithBinary == CL_FALSE){
             int line;
         
@@ -158,6 +184,9 @@ cl_program program)
         if(program->buildOptions){
             free(program->buildOptions);
         }
+        build_dir_remove(program->buildDir);
+        free(program->buildDir);
+        pthread_mutex_destroy(&(program->build_mutex));
         free(program);
     }
     return CL_SUCCESS;
@@ -171,7 +200,9 @@ const char *options,
 void (CL_CALLBACK *pfn_notify)(cl_program program, void *user_data),
 void *user_data)
 {
-    char cmd[256];
+    char cmd[PATH_MAX + 128];
+    char path[PATH_MAX];
+    CacheKey key;
     DEBUG("clBuildProgram called\n");
     if(program == NULL){
         DEBUG("Warning: Program is NULL");
@@ -191,7 +222,8 @@ void *user_data)
     DEBUG("clBuildProgram: buildoptions %s\n", options);
 //     cl_program_sanitizeBuildOptions(options, safeOptions);
     DEBUG("clBuildProgram: safe buildoptions %s\n", options);
-    FILE *optionsFile = fopen("tmp.options", "wb+");
+    snprintf(path, sizeof(path), "%s/tmp.options", program->buildDir);
+    FILE *optionsFile = fopen(path, "wb+");
     if (optionsFile != NULL){
         fwrite("CLFLAGS=\"", 9, 1, optionsFile);
         fwrite(options, strlen(options), 1, optionsFile);
@@ -204,7 +236,8 @@ void *user_data)
         return CL_BUILD_PROGRAM_FAILURE;
     }
     
-    FILE *srcFile = fopen("tmp.cl", "wb+");
+    snprintf(path, sizeof(path), "%s/tmp.cl", program->buildDir);
+    FILE *srcFile = fopen(path, "wb+");
     
     if (srcFile != NULL){
         int line;
@@ -214,16 +247,27 @@ void *user_data)
         }
         fclose(srcFile);
         
-        DEBUG("%s: performing program build\n", __func__);
-        snprintf(cmd, 256, "$NOVELCLSDKROOT/scripts/buildprogram.sh tmp.cl "); 
-        DEBUG("RUN: %s", cmd);
-        if(system(cmd)){
-            DEBUG("%s: program build error\n", __func__);
-            program->buildStatus = CL_BUILD_ERROR;
-            return CL_BUILD_PROGRAM_FAILURE;
+        cache_key_init(&key, "program");
+        cache_key_add(&key, options);
+        cache_key_add_file(&key, path);
+        snprintf(path, sizeof(path), "%s/include/kernel.h", getenv("NOVELCLSDKROOT") ? getenv("NOVELCLSDKROOT") : ".");
+        cache_key_add_file(&key, path);
+        if(!cache_lookup(&key, program->buildDir, program_files)){
+            DEBUG("%s: performing program build\n", __func__);
+            snprintf(cmd, sizeof(cmd), "cd '%s' && $NOVELCLSDKROOT/scripts/buildprogram.sh tmp.cl", program->buildDir); 
+            DEBUG("RUN: %s", cmd);
+            if(system(cmd)){
+                DEBUG("%s: program build error\n", __func__);
+                cache_key_free(&key);
+                program->buildStatus = CL_BUILD_ERROR;
+                return CL_BUILD_PROGRAM_FAILURE;
+            }
+            cache_store(&key, program->buildDir, program_files);
         }
+        cache_key_free(&key);
         DEBUG("%s: program build success\n", __func__);
-        FILE * binaryFile = fopen("program.o", "rb");
+        snprintf(path, sizeof(path), "%s/program.o", program->buildDir);
+        FILE * binaryFile = fopen(path, "rb");
         if(binaryFile != NULL){
             fseek(binaryFile, 0L, SEEK_END);
             program->binarySize = ftell(binaryFile);
@@ -289,7 +333,9 @@ cl_int clGetProgramInfo (cl_program program,
         case CL_PROGRAM_BINARIES:
             if(param_value != NULL){
                 if(program->buildStatus == CL_BUILD_SUCCESS){
-                    FILE * binaryFile = fopen("program.o", "rb");
+                    char path[PATH_MAX];
+                    snprintf(path, sizeof(path), "%s/program.o", program->buildDir);
+                    FILE * binaryFile = fopen(path, "rb");
                     if(binaryFile != NULL){
                         int byteRead;
                         byteRead = fread(((void **)param_value)[0], 1, program->binarySize, binaryFile);
@@ -11,6 +11,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <endian.h>
+#include <sys/uio.h>
 #include "dev_interface.h"
 
 
@@ -70,39 +73,67 @@ int dev_connect(enum conn_type type)
 
 
 
-ssize_t dev_read(int fd, void* buffer, size_t len){
-    ssize_t rcount = 0;
+/*! Drops the first count bytes from an iovec array, returns the new start */
+static struct iovec *dev_iov_advance(struct iovec *iov, int *iovcnt, size_t count){
+    while(*iovcnt > 0 && count >= iov->iov_len){
+        count -= iov->iov_len;
+        iov++;
+        (*iovcnt)--;
+    }
+    if(*iovcnt > 0){
+        iov->iov_base = (char *)iov->iov_base + count;
+        iov->iov_len -= count;
+    }
+    return iov;
+}
+
+
+
+ssize_t dev_readv(int fd, struct iovec *iov, int iovcnt){
+    ssize_t rcount;
     size_t total = 0;
 
-    while(total < len){
-        rcount = read(fd, buffer, len);
+    DEBUG("DEVICE: dev_readv(%d)\n", iovcnt);
+
+    iov = dev_iov_advance(iov, &iovcnt, 0);
+    while(iovcnt > 0){
+        rcount = readv(fd, iov, iovcnt);
         if(rcount < 0){
+            if(errno == EINTR)
+                continue;
             perror("Unable to read data from device");
             return -1;
         }
+        if(rcount == 0){
+            fprintf(stderr, "Device closed the connection\n");
+            return -1;
+        }
         total += rcount;
+        iov = dev_iov_advance(iov, &iovcnt, rcount);
     }
-    DEBUG("DEVICE: dev_read(%p)\n", buffer);
 
     return total;
 }
 
 
 
-ssize_t dev_write(int fd, void* buffer, size_t len){
-    ssize_t wcount = 0;
+ssize_t dev_writev(int fd, struct iovec *iov, int iovcnt){
+    ssize_t wcount;
     size_t total = 0;
 
+    DEBUG("DEVICE: dev_writev(%d)\n", iovcnt);
 
-    DEBUG("DEVICE: dev_write(%p)\n", buffer);
-
-    while(total < len){
-        wcount = write(fd, buffer, len);
+    iov = dev_iov_advance(iov, &iovcnt, 0);
+    while(iovcnt > 0){
+        wcount = writev(fd, iov, iovcnt);
         if(wcount < 0){
-            perror("Unable to writa data to device");
+            if(errno == EINTR)
+                continue;
+            perror("Unable to write data to device");
             return -1;
         }
         total += wcount;
+        iov = dev_iov_advance(iov, &iovcnt, wcount);
     }
 
     return total;
@@ -110,25 +141,60 @@ ssize_t dev_write(int fd, void* buffer, size_t len){
 
 
 
-int dev_set_kernel_args(char* arglist){
-    FILE *argfile;
-    int count;
+int dev_hello(int fd, uint64_t context, uint64_t *memSize){
+    CommPacket_t pkt;
+    const size_t len = COMM_HEADER_LENGTH + sizeof(Hello_t);
+
+    DEBUG("DEVICE: dev_hello\n");
 
-    DEBUG("DEVICE: dev_set_kernel_args\n");
- 
-    argfile = fopen("kernelargs","w+");
-    if(argfile == NULL)
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.version = MORACL_PROTOCOL_VERSION;
+    pkt.cmdId = HELLO;
+    pkt.length = htonl(len);
+    pkt.payload.hello.version = htonl(MORACL_PROTOCOL_VERSION);
+    pkt.payload.hello.memSize = 0;
+    pkt.payload.hello.context = htobe64(context);
+    if(dev_write(fd, &pkt, len) < 0 || dev_read(fd, &pkt, COMM_HEADER_LENGTH) < 0){
         return -1;
-    count = fprintf(argfile,"%s",arglist);
-    fclose(argfile);
-    if(count < 0)
+    }
+    if(pkt.cmdId != CTRL_ACK || ntohl(pkt.length) < len){
+        fprintf(stderr, "Device refused protocol version %d\n", MORACL_PROTOCOL_VERSION);
         return -1;
-
+    }
+    if(dev_read(fd, &pkt.payload.hello, sizeof(Hello_t)) < 0){
+        return -1;
+    }
+    if(ntohl(pkt.payload.hello.version) != MORACL_PROTOCOL_VERSION){
+        fprintf(stderr, "Device speaks protocol version %d, host %d\n", 
+                ntohl(pkt.payload.hello.version), MORACL_PROTOCOL_VERSION);
+        return -1;
+    }
+    if(memSize){
+        *memSize = be64toh(pkt.payload.hello.memSize);
+    }
     return 0;
 }
 
 
 
+ssize_t dev_read(int fd, void* buffer, size_t len){
+    struct iovec iov = {buffer, len};
+
+    DEBUG("DEVICE: dev_read(%p)\n", buffer);
+    return dev_readv(fd, &iov, 1);
+}
+
+
+
+ssize_t dev_write(int fd, void* buffer, size_t len){
+    struct iovec iov = {buffer, len};
+
+    DEBUG("DEVICE: dev_write(%p)\n", buffer);
+    return dev_writev(fd, &iov, 1);
+}
+
+
+
 int dev_disconnect(int fd){
     DEBUG("DEVICE: dev_disconnect\n");
     return close(fd);
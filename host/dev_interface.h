@@ -5,30 +5,95 @@
 #ifndef DEV_INTERFACE_H
 #define DEV_INTERFACE_H
 
+#include <sys/uio.h>
+
 
 enum conn_type {CONN_CTRL, CONN_DATA};
 
 #define PACKED_STRUCT __attribute__((packed))
-#define MORACL_PROTOCOL_VERSION 1
+#define MORACL_PROTOCOL_VERSION 7
 
 #define RESET                   0x00
 #define MEM_WRITE_CMD           0x01
 #define MEM_READ_CMD            0x02
 #define MEM_READ_RSP_CMD        0x03
 #define LOAD_KERNEL_IMAGE       0x04
-#define START_KERNEL            0x05
-#define GLOBAL_WORK_SIZE        0x06
+#define HELLO                   0x07
+#define LAUNCH_KERNEL           0x08
+#define KERNEL_DONE             0x09
+#define OFFER_KERNEL            0x0A
 
 #define CTRL_ACK                     0xFE
 #define CTRL_NAK                     0xFF
 
+/* Packet flags */
+#define MORACL_FLAG_MORE        0x0001  /* More chunks of this transfer follow, 
+                                           only the last one is answered */
+
+#define COMM_HEADER_LENGTH      12          /* version, cmdId, flags, length, id */
+#define MORACL_CHUNK_SIZE       (32*1024)   /* Largest data chunk in one packet */
+#define MORACL_ARG_BLOCK_SIZE   8192        /* Largest kernel argument block */
+#define MORACL_MAX_RANGES       64          /* Most memory ranges one launch declares */
+#define MORACL_SESSION_KERNELS  16          /* Kernels a session holds, least recently 
+                                               offered, uploaded or launched go first */
+
+/* The device answers with its own version and global memory size. Sessions
+   naming the same context share an address space, one that is dropped with 
+   the context's last session; context 0 gets no memory. */
+typedef struct {
+  uint32_t version;
+  uint64_t memSize;
+  uint64_t context;
+} PACKED_STRUCT Hello_t;
+
 typedef struct {
   uint32_t globalX;
   uint32_t globalY;
   uint32_t globalZ;
 } PACKED_STRUCT GlobalWorkSize_t;
 
+/* Memory range flags */
+#define MORACL_RANGE_WRITE      0x0001  /* The kernel may write to the range */
+
+/* Device memory a kernel may touch */
+typedef struct {
+  uint64_t offset;
+  uint64_t length;
+  uint32_t flags;
+} PACKED_STRUCT MemRange_t;
+
+/* Work size, offset of the first work item and the argument block the 
+   kernel wrapper reads its arguments from. The block is laid out by the host
+   for the wrapper it generated and is passed through untouched, in host byte
+   order. rangeCount MemRange_t follow the block; memory transfers that 
+   overlap them wait for the kernel, others go ahead while it runs. 
+   The launch is acked as soon as it is queued, KERNEL_DONE follows when it 
+   has run. kernel is the hash of a kernel the session holds, offered or 
+   uploaded earlier; a session keeps the MORACL_SESSION_KERNELS it used 
+   last. */
+typedef struct {
+  uint64_t kernel;
+  GlobalWorkSize_t globalWorkSize;
+  GlobalWorkSize_t globalWorkOffset;
+  uint32_t argSize;
+  uint32_t rangeCount;
+  uint8_t args[0];
+} PACKED_STRUCT LaunchKernel_t;
+
+/* A kernel image is offered by its FNV-1a hash and size first. The device
+   ACKs if it holds the image, which the session then holds as well, and 
+   NAKs if it has to be uploaded. Images come from hosts that run code on 
+   the device anyway, the hash only has to tell images apart. */
 typedef struct {
+  uint64_t hash;
+  uint32_t size;
+} PACKED_STRUCT KernelOffer_t;
+
+/* Chunk of a kernel image; the device checks the hash of the whole image.
+   The session holds the image from the last chunk on, launches of it wait
+   while it loads; the last chunk is answered once it has loaded. */
+typedef struct {
+  uint64_t hash;
   uint32_t totalSize;
   uint32_t offset;
   uint32_t dataSize;
@@ -36,20 +101,43 @@ typedef struct {
 } PACKED_STRUCT LoadKernel_t;
 
 typedef struct {
-  uint32_t offset;
-  uint32_t accessLength;
+  uint64_t offset;
+  uint64_t accessLength;
   uint8_t data[0];
 } PACKED_STRUCT MemReadWrite_t;
 
+/* When a kernel ran, device clock in ns */
+typedef struct {
+  uint64_t received;
+  uint64_t start;
+  uint64_t end;
+  uint64_t sent;
+} PACKED_STRUCT KernelTiming_t;
+
+/* Sent for every acked launch once it has run. Status 0 means it ran. */
+typedef struct {
+  uint32_t status;
+  KernelTiming_t timing;
+} PACKED_STRUCT KernelDone_t;
+
+/* All multi-byte fields are big endian, length covers the whole packet. 
+   Every answer carries the id of the request it answers: ACK, NAK and 
+   MEM_READ_RSP that of the request, KERNEL_DONE that of the launch. Answers
+   may come in any order; chunks of one transfer share an id. */
 typedef struct {
   uint8_t version;
-  uint16_t length;
   uint8_t cmdId;
+  uint16_t flags;
+  uint32_t length;
+  uint32_t id;
   union {
     MemReadWrite_t write;
     MemReadWrite_t read;
     LoadKernel_t loadkernel;
-    GlobalWorkSize_t globalWorkSize;
+    KernelOffer_t offer;
+    LaunchKernel_t launch;
+    KernelDone_t done;
+    Hello_t hello;
   } payload;
 } PACKED_STRUCT CommPacket_t;
   
@@ -61,6 +149,18 @@ int dev_connect(enum conn_type);
 
 
 
+/**
+ * agree on the protocol version with a freshly connected device
+ * @param fd file descriptor of the connected device
+ * @param context address space to use, shared by connections naming the 
+ *        same one; 0 for a connection that does not touch memory
+ * @param memSize returns the device's global memory size, may be NULL
+ * @return 0 if the device speaks MORACL_PROTOCOL_VERSION, -1 otherwise.
+ */
+int dev_hello(int fd, uint64_t context, uint64_t *memSize);
+
+
+
 /**
  * read from device
  * @param fd file descriptor of the connected device
@@ -83,12 +183,24 @@ ssize_t dev_write(int fd, void* buffer, size_t len);
 
 
 /**
- * Set up device kernel arguments (called before kernel compilation)
- * Format: "offset size\n"
- * @param arglist string representing kernel arguments, separated by newlines
- * @return 0 on success, -1 on error.
+ * scatter read from device, retrying until every vector is filled
+ * @param fd file descriptor of the connected device
+ * @param iov vectors to fill in order, modified as data arrives
+ * @param iovcnt number of vectors
+ * @return actual number of bytes read, -1 on error or disconnect.
+ */
+ssize_t dev_readv(int fd, struct iovec *iov, int iovcnt);
+
+
+
+/**
+ * gather write to device, retrying until every vector is sent
+ * @param fd file descriptor of the connected device
+ * @param iov vectors to send in order, modified as data is sent
+ * @param iovcnt number of vectors
+ * @return actual number of bytes written, -1 on error.
  */
-int dev_set_kernel_args(char* arglist);
+ssize_t dev_writev(int fd, struct iovec *iov, int iovcnt);
 
 
 /**
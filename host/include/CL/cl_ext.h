@@ -137,6 +137,38 @@ typedef CL_API_ENTRY cl_int (CL_API_CALL *clIcdGetPlatformIDsKHR_fn)(
 #define CL_DEVICE_PROFILING_TIMER_OFFSET_AMD        0x4036
 
 
+/*************************************
+* cl_novel_device_memory_statistics *
+*************************************/
+/* Device memory allocator statistics. Every context has an address space
+   of its own: clGetContextInfo returns the figures of one context, 
+   clGetDeviceInfo those of all live contexts of the process summed up, 
+   with largest_free the largest in any of them */
+#define CL_DEVICE_MEMORY_STATISTICS_NOVEL           0x4F00
+#define CL_CONTEXT_MEMORY_STATISTICS_NOVEL          0x4F02
+
+typedef struct _cl_memory_statistics_novel {
+    cl_ulong size;          /* Device memory handed out by clCreateBuffer */
+    cl_ulong used;          /* Bytes allocated, including alignment padding */
+    cl_ulong high_water;    /* Highest value used has reached */
+    cl_ulong largest_free;  /* Largest buffer that can still be allocated */
+    cl_uint  allocations;   /* Live buffers */
+    cl_uint  free_blocks;   /* Free ranges, more than one means fragmentation */
+    cl_uint  failures;      /* Buffers refused for lack of device memory */
+} cl_memory_statistics_novel;
+
+/* Host build cache statistics, returned by clGetDeviceInfo */
+#define CL_DEVICE_BUILD_CACHE_STATISTICS_NOVEL      0x4F01
+
+typedef struct _cl_build_cache_statistics_novel {
+    cl_ulong hits;          /* Builds served from the cache */
+    cl_ulong misses;        /* Builds that had to run the compiler */
+    cl_ulong stores;        /* Builds added to the cache */
+    cl_ulong evictions;     /* Entries removed to stay within the size limit */
+    cl_ulong bytes;         /* Cache size on disk as of the last store */
+} cl_build_cache_statistics_novel;
+
+
 #ifdef CL_VERSION_1_1
 /***********************************
     * cl_ext_device_fission extension *
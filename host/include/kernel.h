@@ -2,6 +2,19 @@
 
 #include <stdlib.h>
 
+/* Work-item context, set by the kernel wrapper before it runs each work 
+ * item. Compute units run work items side by side, so it is per thread. It
+ * lives in the device executable, which makes the initial-exec model safe 
+ * for kernels loaded at run time: reads are a single load. Work groups are 
+ * a single work item. */
+typedef struct {
+	size_t global_id[3];
+	size_t global_size[3];
+	size_t global_offset[3];
+} novelcl_context_t;
+
+extern __thread novelcl_context_t novelcl_context __attribute__((tls_model("initial-exec")));
+
 #define __global
 #define global
 #define __local
@@ -18,14 +31,29 @@ typedef unsigned int uint;
 
 #define max(x,y) ((x >= y)?x:y)
 
-extern size_t get_global_id(unsigned int dimindex);
-extern size_t get_global_size(unsigned int dimindex);
+static inline size_t get_global_id(unsigned int dimindex){
+	return (dimindex < 3) ? novelcl_context.global_id[dimindex] : 0;
+}
+static inline size_t get_global_size(unsigned int dimindex){
+	return (dimindex < 3) ? novelcl_context.global_size[dimindex] : 1;
+}
+static inline size_t get_global_offset(unsigned int dimindex){
+	return (dimindex < 3) ? novelcl_context.global_offset[dimindex] : 0;
+}
 
-extern size_t get_local_id(unsigned int dimindex);
-extern size_t get_local_size(unsigned int dimindex);
+static inline size_t get_local_id(unsigned int dimindex){
+	return 0;
+}
+static inline size_t get_local_size(unsigned int dimindex){
+	return 1;
+}
 
-extern size_t get_group_id(unsigned int dimindex);
-extern size_t get_num_groups(unsigned int dimindex);
+static inline size_t get_group_id(unsigned int dimindex){
+	return get_global_id(dimindex) - get_global_offset(dimindex);
+}
+static inline size_t get_num_groups(unsigned int dimindex){
+	return get_global_size(dimindex);
+}
 
 uint rotate(uint i, uint j){
 	return (i << j) | i >> (32 - j);
@@ -1,6 +1,7 @@
 #!/bin/bash
 
 # build an OpenCL kernel using gcc
+# runs in the program's private build directory, which holds tmp.options
 
 src=$1
 target=$1.o
@@ -12,17 +13,13 @@ then
 
 elif [ $1=~.*".cl" -a -e $1 ] #if file exists and matches .cl
 then
-    if [ $1 -ot ${target} ] #check if source is older than target
-    then
-        echo "nothing to do"
-        exit 0
-    else
-        source tmp.options
-        ( echo -e "#include \"kernel.h\""; cat ${src} ) > ${src}.tmp #append header to source
-        gcc -I$NOVELCLSDKROOT/include -fPIC -Wno-implicit-function-declaration ${CLFLAGS} -g -O2 -x c -std=c99 -c -o ${target} ${src}.tmp
-        mv ${target} program.o
-        exit 0
-    fi
+    source tmp.options
+    ( echo -e "#include \"kernel.h\""; cat ${src} ) > ${src}.tmp #append header to source
+    # kernel signatures are read from, and kernel images compiled from, the preprocessed source
+    gcc -E -P -I$NOVELCLSDKROOT/include ${CLFLAGS} -x c -std=c99 -o program.i ${src}.tmp || exit 1
+    gcc -fPIC -Wno-implicit-function-declaration ${CLFLAGS} -g -O2 -x c -std=c99 -c -o ${target} program.i || exit 1
+    mv ${target} program.o
+    exit 0
 else
     echo "incorrect argument"
     exit 1